@@ -0,0 +1,284 @@
+#include "AABBTree.h"
+
+#include <algorithm>
+#include <glm/glm.hpp>
+
+constexpr float AABBTree::FatMargin;
+constexpr float AABBTree::DisplacementMultiplier;
+
+
+static Bounds Union(const Bounds& bounds1, const Bounds& bounds2)
+{
+	return Bounds{ glm::min(bounds1.min, bounds2.min), glm::max(bounds1.max, bounds2.max) };
+}
+
+static float SurfaceArea(const Bounds& bounds)
+{
+	glm::vec3 size = bounds.max - bounds.min;
+	return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+static bool Contains(const Bounds& outer, const Bounds& inner)
+{
+	return glm::all(glm::lessThanEqual(outer.min, inner.min)) && glm::all(glm::greaterThanEqual(outer.max, inner.max));
+}
+
+
+int32_t AABBTree::Insert(uint32_t userId, const Bounds& bounds)
+{
+	int32_t leaf = AllocateNode();
+	Node& node = m_nodes[leaf];
+	node.bounds = Bounds{ bounds.min - FatMargin, bounds.max + FatMargin };
+	node.userId = userId;
+	node.height = 0;
+
+	InsertLeaf(leaf);
+	m_leafCount++;
+	return leaf;
+}
+
+void AABBTree::Remove(int32_t leaf)
+{
+	assert(m_nodes[leaf].IsLeaf());
+
+	RemoveLeaf(leaf);
+	FreeNode(leaf);
+	m_leafCount--;
+}
+
+bool AABBTree::Move(int32_t leaf, const Bounds& bounds, glm::vec3 displacement)
+{
+	assert(m_nodes[leaf].IsLeaf());
+
+	if (Contains(m_nodes[leaf].bounds, bounds)) {
+		return false;
+	}
+
+	RemoveLeaf(leaf);
+
+	// Fatten the bounds, and stretch them in the direction of travel
+	Bounds fatBounds{ bounds.min - FatMargin, bounds.max + FatMargin };
+	glm::vec3 predictedDisplacement = displacement * DisplacementMultiplier;
+	fatBounds.min += glm::min(predictedDisplacement, glm::vec3(0));
+	fatBounds.max += glm::max(predictedDisplacement, glm::vec3(0));
+
+	m_nodes[leaf].bounds = fatBounds;
+	InsertLeaf(leaf);
+	return true;
+}
+
+int32_t AABBTree::AllocateNode()
+{
+	int32_t node;
+	if (m_freeList != NullNode) {
+		node = m_freeList;
+		m_freeList = m_nodes[node].parent;
+	}
+	else {
+		node = static_cast<int32_t>(m_nodes.size());
+		m_nodes.emplace_back();
+	}
+
+	m_nodes[node].parent = NullNode;
+	m_nodes[node].child1 = NullNode;
+	m_nodes[node].child2 = NullNode;
+	m_nodes[node].height = 0;
+	return node;
+}
+
+void AABBTree::FreeNode(int32_t node)
+{
+	m_nodes[node].parent = m_freeList;
+	m_nodes[node].height = -1;
+	m_freeList = node;
+}
+
+void AABBTree::InsertLeaf(int32_t leaf)
+{
+	if (m_root == NullNode) {
+		m_root = leaf;
+		m_nodes[leaf].parent = NullNode;
+		return;
+	}
+
+	// Walk down to the sibling that increases the total surface area of the tree the least
+	const Bounds leafBounds = m_nodes[leaf].bounds;
+	int32_t index = m_root;
+	while (!m_nodes[index].IsLeaf())
+	{
+		const Node& node = m_nodes[index];
+		float area = SurfaceArea(node.bounds);
+		float combinedArea = SurfaceArea(Union(node.bounds, leafBounds));
+
+		// Cost of making a new parent for this node and the leaf
+		float cost = 2.0f * combinedArea;
+
+		// Minimum cost of pushing the leaf further down the tree
+		float inheritanceCost = 2.0f * (combinedArea - area);
+
+		auto descendCost = [&](int32_t child) {
+			const Node& childNode = m_nodes[child];
+			float newArea = SurfaceArea(Union(childNode.bounds, leafBounds));
+			if (childNode.IsLeaf()) return newArea + inheritanceCost;
+			return (newArea - SurfaceArea(childNode.bounds)) + inheritanceCost;
+		};
+
+		float cost1 = descendCost(node.child1);
+		float cost2 = descendCost(node.child2);
+
+		if (cost < cost1 && cost < cost2) break;
+
+		index = cost1 < cost2 ? node.child1 : node.child2;
+	}
+
+	int32_t sibling = index;
+
+	// Make a new parent for the leaf and sibling
+	int32_t oldParent = m_nodes[sibling].parent;
+	int32_t newParent = AllocateNode();
+	m_nodes[newParent].parent = oldParent;
+	m_nodes[newParent].bounds = Union(leafBounds, m_nodes[sibling].bounds);
+	m_nodes[newParent].height = m_nodes[sibling].height + 1;
+	m_nodes[newParent].child1 = sibling;
+	m_nodes[newParent].child2 = leaf;
+	m_nodes[sibling].parent = newParent;
+	m_nodes[leaf].parent = newParent;
+
+	if (oldParent == NullNode) {
+		m_root = newParent;
+	}
+	else if (m_nodes[oldParent].child1 == sibling) {
+		m_nodes[oldParent].child1 = newParent;
+	}
+	else {
+		m_nodes[oldParent].child2 = newParent;
+	}
+
+	RefitAncestors(m_nodes[leaf].parent);
+}
+
+void AABBTree::RemoveLeaf(int32_t leaf)
+{
+	if (leaf == m_root) {
+		m_root = NullNode;
+		return;
+	}
+
+	int32_t parent = m_nodes[leaf].parent;
+	int32_t grandParent = m_nodes[parent].parent;
+	int32_t sibling = m_nodes[parent].child1 == leaf ? m_nodes[parent].child2 : m_nodes[parent].child1;
+
+	// The sibling takes the parent's place
+	FreeNode(parent);
+	m_nodes[sibling].parent = grandParent;
+
+	if (grandParent == NullNode) {
+		m_root = sibling;
+		return;
+	}
+
+	if (m_nodes[grandParent].child1 == parent) {
+		m_nodes[grandParent].child1 = sibling;
+	}
+	else {
+		m_nodes[grandParent].child2 = sibling;
+	}
+
+	RefitAncestors(grandParent);
+}
+
+void AABBTree::RefitAncestors(int32_t index)
+{
+	while (index != NullNode)
+	{
+		index = Balance(index);
+
+		Node& node = m_nodes[index];
+		const Node& child1 = m_nodes[node.child1];
+		const Node& child2 = m_nodes[node.child2];
+
+		node.height = 1 + std::max(child1.height, child2.height);
+		node.bounds = Union(child1.bounds, child2.bounds);
+
+		index = node.parent;
+	}
+}
+
+// If one child of a node is more than one level taller than the other, rotate the taller
+//   child up into its place. Returns the node now at the top of this subtree.
+int32_t AABBTree::Balance(int32_t indexA)
+{
+	Node& A = m_nodes[indexA];
+	if (A.IsLeaf() || A.height < 2) {
+		return indexA;
+	}
+
+	int32_t indexB = A.child1;
+	int32_t indexC = A.child2;
+	int32_t balance = m_nodes[indexC].height - m_nodes[indexB].height;
+
+	if (balance > 1 || balance < -1) {
+		// Rotate the taller child (up) above A
+		int32_t indexUp = balance > 1 ? indexC : indexB;
+		int32_t indexOther = balance > 1 ? indexB : indexC;
+		Node& up = m_nodes[indexUp];
+
+		int32_t indexF = up.child1;
+		int32_t indexG = up.child2;
+		Node& F = m_nodes[indexF];
+		Node& G = m_nodes[indexG];
+
+		// A becomes a child of up
+		up.child1 = indexA;
+		up.parent = A.parent;
+		A.parent = indexUp;
+
+		if (up.parent == NullNode) {
+			m_root = indexUp;
+		}
+		else if (m_nodes[up.parent].child1 == indexA) {
+			m_nodes[up.parent].child1 = indexUp;
+		}
+		else {
+			m_nodes[up.parent].child2 = indexUp;
+		}
+
+		// The taller grandchild stays with up, the shorter one moves under A
+		int32_t indexKeep = F.height > G.height ? indexF : indexG;
+		int32_t indexMove = F.height > G.height ? indexG : indexF;
+		Node& keep = m_nodes[indexKeep];
+		Node& move = m_nodes[indexMove];
+		const Node& other = m_nodes[indexOther];
+
+		up.child2 = indexKeep;
+		if (balance > 1) {
+			A.child2 = indexMove;
+		}
+		else {
+			A.child1 = indexMove;
+		}
+		move.parent = indexA;
+
+		A.bounds = Union(other.bounds, move.bounds);
+		A.height = 1 + std::max(other.height, move.height);
+		up.bounds = Union(A.bounds, keep.bounds);
+		up.height = 1 + std::max(A.height, keep.height);
+
+		return indexUp;
+	}
+
+	return indexA;
+}
+
+bool AABBTree::RayIntersects(const Bounds& bounds, glm::vec3 origin, glm::vec3 inverseDirection, float maxDistance)
+{
+	// Slab test
+	glm::vec3 t1 = (bounds.min - origin) * inverseDirection;
+	glm::vec3 t2 = (bounds.max - origin) * inverseDirection;
+	glm::vec3 tMin = glm::min(t1, t2);
+	glm::vec3 tMax = glm::max(t1, t2);
+
+	float enter = std::max(std::max(tMin.x, tMin.y), std::max(tMin.z, 0.0f));
+	float exit = std::min(std::min(tMax.x, tMax.y), std::min(tMax.z, maxDistance));
+	return enter <= exit;
+}
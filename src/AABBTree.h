@@ -0,0 +1,137 @@
+#pragma once
+
+#include "Bounds.h"
+
+#include <assert.h>
+#include <cstdint>
+#include <vector>
+
+// A dynamic bounding volume hierarchy.
+// Leaves store fattened bounds so small movements don't change the tree, and the tree is
+//   kept balanced with rotations as leaves are inserted and removed.
+// Based on the dynamic tree in Box2D.
+class AABBTree
+{
+public:
+	static const int32_t NullNode = -1;
+
+	// Added to each side of a leaf's bounds
+	static constexpr float FatMargin = 0.1f;
+	// How far ahead of a moving leaf to extend its bounds, as a multiple of how far it moved
+	static constexpr float DisplacementMultiplier = 2.0f;
+
+	AABBTree() : m_root(NullNode), m_freeList(NullNode), m_leafCount(0) {}
+
+	// Returns the leaf to use with the other functions
+	int32_t Insert(uint32_t userId, const Bounds& bounds);
+	void Remove(int32_t leaf);
+
+	// Reinserts the leaf if it moved out of its fat bounds, returns true when it did.
+	bool Move(int32_t leaf, const Bounds& bounds, glm::vec3 displacement);
+
+	const Bounds& GetFatBounds(int32_t leaf) const { return m_nodes[leaf].bounds; }
+	uint32_t GetUserId(int32_t leaf) const { return m_nodes[leaf].userId; }
+	int GetHeight() const { return m_root == NullNode ? 0 : m_nodes[m_root].height; }
+	int GetLeafCount() const { return m_leafCount; }
+
+	// Calls callback(userId) for each leaf overlapping the bounds, stops when it returns false.
+	template<typename Callback>
+	void Query(const Bounds& bounds, Callback callback) const;
+
+	// Calls callback(userId, maxDistance) for each leaf the ray passes through. The callback
+	//   returns the new max distance so that hits further away can be skipped, 0 stops the cast.
+	template<typename Callback>
+	void RayCast(glm::vec3 origin, glm::vec3 direction, float maxDistance, Callback callback) const;
+	// The same for a box with its center moving along the ray, it passes through leaves
+	//   whose bounds grown by its extents the ray passes through.
+	template<typename Callback>
+	void BoxCast(glm::vec3 origin, glm::vec3 extents, glm::vec3 direction, float maxDistance, Callback callback) const;
+
+private:
+	static const int MaxStackDepth = 256;
+
+	struct Node
+	{
+		Bounds bounds;
+		uint32_t userId;
+		int32_t parent; // The next free node when on the free list
+		int32_t child1;
+		int32_t child2;
+		int32_t height; // 0 for leaves
+
+		bool IsLeaf() const { return child1 == NullNode; }
+	};
+
+	int32_t AllocateNode();
+	void FreeNode(int32_t node);
+
+	void InsertLeaf(int32_t leaf);
+	void RemoveLeaf(int32_t leaf);
+	void RefitAncestors(int32_t node);
+	int32_t Balance(int32_t node);
+
+	static bool RayIntersects(const Bounds& bounds, glm::vec3 origin, glm::vec3 inverseDirection, float maxDistance);
+	static Bounds Grow(const Bounds& bounds, glm::vec3 extents) { return Bounds{ bounds.min - extents, bounds.max + extents }; }
+
+	int32_t m_root;
+	int32_t m_freeList;
+	int m_leafCount;
+	std::vector<Node> m_nodes;
+};
+
+
+template<typename Callback>
+void AABBTree::Query(const Bounds& bounds, Callback callback) const
+{
+	int32_t stack[MaxStackDepth];
+	int stackCount = 0;
+	if (m_root != NullNode) stack[stackCount++] = m_root;
+
+	while (stackCount > 0)
+	{
+		const Node& node = m_nodes[stack[--stackCount]];
+		if (!node.bounds.Overlaps(bounds)) continue;
+
+		if (node.IsLeaf()) {
+			if (!callback(node.userId)) return;
+		}
+		else {
+			assert(stackCount + 2 <= MaxStackDepth);
+			stack[stackCount++] = node.child1;
+			stack[stackCount++] = node.child2;
+		}
+	}
+}
+
+template<typename Callback>
+void AABBTree::RayCast(glm::vec3 origin, glm::vec3 direction, float maxDistance, Callback callback) const
+{
+	BoxCast(origin, glm::vec3(0), direction, maxDistance, callback);
+}
+
+template<typename Callback>
+void AABBTree::BoxCast(glm::vec3 origin, glm::vec3 extents, glm::vec3 direction, float maxDistance, Callback callback) const
+{
+	// Division by zero gives infinity, which the slab test handles
+	glm::vec3 inverseDirection = 1.0f / direction;
+
+	int32_t stack[MaxStackDepth];
+	int stackCount = 0;
+	if (m_root != NullNode) stack[stackCount++] = m_root;
+
+	while (stackCount > 0)
+	{
+		const Node& node = m_nodes[stack[--stackCount]];
+		if (!RayIntersects(Grow(node.bounds, extents), origin, inverseDirection, maxDistance)) continue;
+
+		if (node.IsLeaf()) {
+			maxDistance = callback(node.userId, maxDistance);
+			if (maxDistance <= 0) return;
+		}
+		else {
+			assert(stackCount + 2 <= MaxStackDepth);
+			stack[stackCount++] = node.child1;
+			stack[stackCount++] = node.child2;
+		}
+	}
+}
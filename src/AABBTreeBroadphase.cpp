@@ -0,0 +1,131 @@
+#include "AABBTreeBroadphase.h"
+
+#include <algorithm>
+#include <limits>
+
+
+void AABBTreeBroadphase::Add(uint32_t id, const Bounds& bounds, bool isStatic)
+{
+	if (id >= m_proxies.size()) {
+		m_proxies.resize(id + 1);
+	}
+	m_proxies[id] = Proxy{ bounds, isStatic, true, AABBTree::NullNode };
+
+	AddToTree(id);
+}
+
+void AABBTreeBroadphase::Remove(uint32_t id)
+{
+	assert(id < m_proxies.size() && m_proxies[id].isActive);
+	RemoveFromTree(id);
+	m_proxies[id].isActive = false;
+}
+
+void AABBTreeBroadphase::Update(uint32_t id, const Bounds& bounds)
+{
+	assert(id < m_proxies.size());
+	Proxy& proxy = m_proxies[id];
+
+	glm::vec3 displacement = bounds.min - proxy.bounds.min;
+	proxy.bounds = bounds;
+
+	// A body can become unbounded, or come back, as it moves.
+	bool wasUnbounded = proxy.leaf == AABBTree::NullNode;
+	if (wasUnbounded != IsUnbounded(bounds)) {
+		RemoveFromTree(id);
+		AddToTree(id);
+	}
+	else if (!wasUnbounded) {
+		GetTree(proxy).Move(proxy.leaf, bounds, displacement);
+	}
+}
+
+void AABBTreeBroadphase::SetStatic(uint32_t id, bool isStatic)
+{
+	assert(id < m_proxies.size());
+	if (m_proxies[id].isStatic == isStatic) return;
+
+	// Moves the body to the other tree
+	RemoveFromTree(id);
+	m_proxies[id].isStatic = isStatic;
+	AddToTree(id);
+}
+
+void AABBTreeBroadphase::FindPairs(std::vector<BroadphasePair>& pairs)
+{
+	for (uint32_t id = 0; id < m_proxies.size(); id++)
+	{
+		const Proxy& proxy = m_proxies[id];
+		if (!proxy.isActive || proxy.isStatic || proxy.leaf == AABBTree::NullNode) continue;
+
+		// Each dynamic pair is seen from both sides, keep the one from the lower id
+		m_dynamicTree.Query(proxy.bounds, [&](uint32_t otherId) {
+			if (otherId > id && m_proxies[otherId].bounds.Overlaps(proxy.bounds)) {
+				pairs.push_back(BroadphasePair{ id, otherId });
+			}
+			return true;
+		});
+
+		m_staticTree.Query(proxy.bounds, [&](uint32_t otherId) {
+			if (m_proxies[otherId].bounds.Overlaps(proxy.bounds)) {
+				pairs.push_back(id < otherId ? BroadphasePair{ id, otherId } : BroadphasePair{ otherId, id });
+			}
+			return true;
+		});
+	}
+
+	FindUnboundedPairs(pairs);
+}
+
+bool AABBTreeBroadphase::IsUnbounded(const Bounds& bounds)
+{
+	// Written so that bounds which aren't finite are also unbounded
+	glm::vec3 size = bounds.max - bounds.min;
+	const float maxSize = std::numeric_limits<float>::max();
+	return !(size.x < maxSize && size.y < maxSize && size.z < maxSize);
+}
+
+void AABBTreeBroadphase::AddToTree(uint32_t id)
+{
+	Proxy& proxy = m_proxies[id];
+	if (IsUnbounded(proxy.bounds)) {
+		proxy.leaf = AABBTree::NullNode;
+		m_unbounded.push_back(id);
+	}
+	else {
+		proxy.leaf = GetTree(proxy).Insert(id, proxy.bounds);
+	}
+}
+
+void AABBTreeBroadphase::RemoveFromTree(uint32_t id)
+{
+	Proxy& proxy = m_proxies[id];
+	if (proxy.leaf == AABBTree::NullNode) {
+		m_unbounded.erase(std::find(std::begin(m_unbounded), std::end(m_unbounded), id));
+	}
+	else {
+		GetTree(proxy).Remove(proxy.leaf);
+		proxy.leaf = AABBTree::NullNode;
+	}
+}
+
+void AABBTreeBroadphase::FindUnboundedPairs(std::vector<BroadphasePair>& pairs)
+{
+	for (uint32_t unboundedId : m_unbounded)
+	{
+		const Proxy& unboundedProxy = m_proxies[unboundedId];
+
+		for (uint32_t id = 0; id < m_proxies.size(); id++)
+		{
+			const Proxy& proxy = m_proxies[id];
+			if (!proxy.isActive) continue;
+
+			// Pairs of unbounded bodies are found once, from the lower id
+			if (proxy.leaf == AABBTree::NullNode && id <= unboundedId) continue;
+			if (proxy.isStatic && unboundedProxy.isStatic) continue;
+			if (!proxy.bounds.Overlaps(unboundedProxy.bounds)) continue;
+
+			pairs.push_back(id < unboundedId ? BroadphasePair{ id, unboundedId } : BroadphasePair{ unboundedId, id });
+		}
+	}
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "AABBTree.h"
+#include "Broadphase.h"
+
+// Keeps static and dynamic bodies in separate AABB trees. Each dynamic body is queried
+//   against both trees, so pairs of static bodies are never visited.
+// Bodies with unbounded extents, like planes, can't be placed in a tree and are tested
+//   against every other body.
+class AABBTreeBroadphase : public Broadphase
+{
+public:
+	void Add(uint32_t id, const Bounds& bounds, bool isStatic) override;
+	void Remove(uint32_t id) override;
+	void Update(uint32_t id, const Bounds& bounds) override;
+	void SetStatic(uint32_t id, bool isStatic) override;
+	void FindPairs(std::vector<BroadphasePair>& pairs) override;
+
+	const AABBTree& GetStaticTree() const { return m_staticTree; }
+	const AABBTree& GetDynamicTree() const { return m_dynamicTree; }
+
+	// Calls callback(id) for each body whose bounds overlap, including unbounded ones.
+	template<typename Callback>
+	void Query(const Bounds& bounds, Callback callback) const;
+
+	// Calls callback(id, maxDistance) for each body whose bounds, grown by the extents, the
+	//   ray passes through, including unbounded ones. See AABBTree::RayCast.
+	template<typename Callback>
+	void BoxCast(glm::vec3 origin, glm::vec3 extents, glm::vec3 direction, float maxDistance, Callback callback) const;
+
+private:
+	struct Proxy
+	{
+		Bounds bounds;
+		bool isStatic;
+		bool isActive;
+		int32_t leaf; // NullNode when the body is unbounded
+	};
+
+	static bool IsUnbounded(const Bounds& bounds);
+
+	AABBTree& GetTree(const Proxy& proxy) { return proxy.isStatic ? m_staticTree : m_dynamicTree; }
+	void AddToTree(uint32_t id);
+	void RemoveFromTree(uint32_t id);
+
+	void FindUnboundedPairs(std::vector<BroadphasePair>& pairs);
+
+	AABBTree m_staticTree;
+	AABBTree m_dynamicTree;
+
+	std::vector<Proxy> m_proxies; // Indexed by id
+	std::vector<uint32_t> m_unbounded;
+};
+
+
+template<typename Callback>
+void AABBTreeBroadphase::Query(const Bounds& bounds, Callback callback) const
+{
+	bool keepGoing = true;
+	auto treeCallback = [&](uint32_t id) {
+		if (m_proxies[id].bounds.Overlaps(bounds)) {
+			keepGoing = callback(id);
+		}
+		return keepGoing;
+	};
+
+	m_dynamicTree.Query(bounds, treeCallback);
+	if (keepGoing) m_staticTree.Query(bounds, treeCallback);
+
+	for (uint32_t id : m_unbounded)
+	{
+		if (!keepGoing) return;
+		treeCallback(id);
+	}
+}
+
+template<typename Callback>
+void AABBTreeBroadphase::BoxCast(glm::vec3 origin, glm::vec3 extents, glm::vec3 direction, float maxDistance, Callback callback) const
+{
+	// Hits in the dynamic tree shorten the cast through the static tree
+	m_dynamicTree.BoxCast(origin, extents, direction, maxDistance, [&](uint32_t id, float distance) {
+		maxDistance = callback(id, distance);
+		return maxDistance;
+	});
+	if (maxDistance <= 0) return;
+
+	m_staticTree.BoxCast(origin, extents, direction, maxDistance, [&](uint32_t id, float distance) {
+		maxDistance = callback(id, distance);
+		return maxDistance;
+	});
+
+	for (uint32_t id : m_unbounded)
+	{
+		if (maxDistance <= 0) return;
+		maxDistance = callback(id, maxDistance);
+	}
+}
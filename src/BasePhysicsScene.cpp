@@ -1,3 +1,32 @@
 #include "BasePhysicsScene.h"
 
 const glm::vec3 BasePhysicsScene::DefaultGravity(0.0f, -9.8f, 0.0f);
+
+void BasePhysicsScene::AddSpheresDynamic(size_t count, const glm::vec3* pPositions, const float* pRadii, const float* pMasses, const glm::vec3* pVelocities, BodyHandle* pHandles)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		BodyHandle handle = AddSphereDynamic(pPositions[i], pRadii[i], pMasses[i], pVelocities[i]);
+		if (pHandles != nullptr) pHandles[i] = handle;
+	}
+}
+
+void BasePhysicsScene::AddAABBsDynamic(size_t count, const glm::vec3* pPositions, const glm::vec3* pExtents, const float* pMasses, const glm::vec3* pVelocities, BodyHandle* pHandles)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		BodyHandle handle = AddAABBDynamic(pPositions[i], pExtents[i], pMasses[i], pVelocities[i]);
+		if (pHandles != nullptr) pHandles[i] = handle;
+	}
+}
+
+void BasePhysicsScene::RaycastBatch(const RaycastQuery* pQueries, size_t count, QueryHit* pHits)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		const RaycastQuery& query = pQueries[i];
+		if (!Raycast(query.origin, query.direction, query.maxDistance, pHits[i], query.layerMask)) {
+			pHits[i].handle = BodyHandle::Invalid();
+		}
+	}
+}
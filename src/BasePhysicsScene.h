@@ -1,6 +1,12 @@
 #pragma once
 
+#include "Bounds.h"
+#include "HandleTable.h"
+#include "Profiler.h"
+#include "SceneQuery.h"
+
 #include <glm/vec3.hpp>
+#include <limits>
 
 class BasePhysicsScene
 {
@@ -12,11 +18,62 @@ public:
 	virtual void Update(float deltaTime) = 0;
 	virtual void Draw() = 0;
 
-	virtual void AddPlaneStatic(glm::vec3 normal, float distance) = 0;
-	virtual void AddSphereStatic(glm::vec3 position, float radius) = 0;
-	virtual void AddAABBStatic(glm::vec3 position, glm::vec3 extents) = 0;
+	virtual BodyHandle AddPlaneStatic(glm::vec3 normal, float distance) = 0;
+	virtual BodyHandle AddSphereStatic(glm::vec3 position, float radius) = 0;
+	virtual BodyHandle AddAABBStatic(glm::vec3 position, glm::vec3 extents) = 0;
+
+	virtual BodyHandle AddPlaneDynamic(glm::vec3 normal, float distance, float mass, glm::vec3 velocity) = 0;
+	virtual BodyHandle AddSphereDynamic(glm::vec3 position, float radius, float mass, glm::vec3 velocity) = 0;
+	virtual BodyHandle AddAABBDynamic(glm::vec3 position, glm::vec3 extents, float mass, glm::vec3 velocity) = 0;
+
+	// Add count dynamic bodies at once, the i-th body from the i-th element of each array.
+	// Much quicker than adding them one at a time when setting up large scenes.
+	// The handles are written to pHandles when it isn't null.
+	virtual void AddSpheresDynamic(size_t count, const glm::vec3* pPositions, const float* pRadii, const float* pMasses, const glm::vec3* pVelocities, BodyHandle* pHandles = nullptr);
+	virtual void AddAABBsDynamic(size_t count, const glm::vec3* pPositions, const glm::vec3* pExtents, const float* pMasses, const glm::vec3* pVelocities, BodyHandle* pHandles = nullptr);
+
+	// Does nothing if the body has already been removed
+	virtual void Remove(BodyHandle handle) = 0;
+	virtual size_t GetBodyCount() const = 0;
+
+	// Scene queries, in the same space bodies are added in. Directions don't need to be
+	//   normalized, distances are along them as though they were.
+	// Every body on a layer in the mask is found, asleep or not.
+	// Queries can't be made during Update or alongside each other, RaycastBatch answers many at once.
+	virtual bool Raycast(glm::vec3 origin, glm::vec3 direction, float maxDistance, QueryHit& hit, uint32_t layerMask = AllQueryLayers) = 0;
+	// Writes the handles of up to maxCount bodies touching the sphere, in no order, returns how many were written
+	virtual size_t OverlapSphere(glm::vec3 center, float radius, BodyHandle* pHandles, size_t maxCount, uint32_t layerMask = AllQueryLayers) = 0;
+	// The first body the box touches, moving without turning from its center along the direction
+	virtual bool SweepBox(glm::vec3 center, glm::vec3 extents, glm::vec3 direction, float maxDistance, QueryHit& hit, uint32_t layerMask = AllQueryLayers) = 0;
+	// Fills in one hit per query, in the same order
+	virtual void RaycastBatch(const RaycastQuery* pQueries, size_t count, QueryHit* pHits);
+
+	// Dynamic bodies are removed once they are older than the max age, in seconds,
+	//   or once their position leaves the bounds. Both are off by default.
+	void SetDespawnAge(float maxAge) { m_despawnAge = maxAge; }
+	void SetDespawnBounds(const Bounds& bounds) { m_despawnBounds = bounds; }
+
+	// Counters from the last Update. Phase times are only filled in while profiling, which is
+	//   off by default.
+	const FrameStats& GetFrameStats() const { return m_profiler.GetStats(); }
+	void SetProfiling(bool isProfiling) { m_profiler.SetEnabled(isProfiling); }
+
+	// Records every phase of every Update until StopTrace writes them out as a Chrome trace,
+	//   for chrome://tracing. Returns false if the file couldn't be written.
+	void StartTrace() { m_profiler.StartTrace(); }
+	bool StopTrace(const char* pPath) { return m_profiler.WriteTrace(pPath); }
+
+protected:
+	Profiler m_profiler;
+
+	bool ShouldDespawn(float age, glm::vec3 position) const
+	{
+		return age > m_despawnAge ||
+			position.x < m_despawnBounds.min.x || position.y < m_despawnBounds.min.y || position.z < m_despawnBounds.min.z ||
+			position.x > m_despawnBounds.max.x || position.y > m_despawnBounds.max.y || position.z > m_despawnBounds.max.z;
+	}
 
-	virtual void AddPlaneDynamic(glm::vec3 normal, float distance, float mass, glm::vec3 velocity) = 0;
-	virtual void AddSphereDynamic(glm::vec3 position, float radius, float mass, glm::vec3 velocity) = 0;
-	virtual void AddAABBDynamic(glm::vec3 position, glm::vec3 extents, float mass, glm::vec3 velocity) = 0;
+private:
+	float m_despawnAge = std::numeric_limits<float>::infinity();
+	Bounds m_despawnBounds = Bounds::Infinite();
 };
@@ -0,0 +1,108 @@
+#include "NarrowphaseBenchmark.h"
+#include "ScalingBenchmark.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// Runs without a window or renderer, so it can be run on a headless build machine
+static void PrintUsage()
+{
+	fprintf(stderr,
+		"PhysicsBenchmark [options]\n"
+		"  --narrowphase          Times the SIMD overlap kernels instead\n"
+		"  --scenario <name>      pile or scatter, every scenario by default\n"
+		"  --broadphase <name>    sap, hash, tree or brute, sap by default\n"
+		"  --bodies <min> <max>   Body counts, 1000 to 1000000 by default\n"
+		"  --threads <max>        Most threads, every hardware thread by default\n"
+		"  --scenes <count>       Copies of the scene stepped side by side, 1 by default\n"
+		"  --steps <count>        Timed steps per run, 30 by default\n"
+		"  --output <file>        Writes the CSV to a file instead of stdout\n"
+		"  --trace <file>         Writes a Chrome trace of the last run, for chrome://tracing\n");
+}
+
+static bool ParseBroadphase(const char* pName, PhysicsScene::BroadphaseType& broadphase)
+{
+	if (strcmp(pName, "sap") == 0) broadphase = PhysicsScene::BroadphaseType::SweepAndPrune;
+	else if (strcmp(pName, "hash") == 0) broadphase = PhysicsScene::BroadphaseType::SpatialHash;
+	else if (strcmp(pName, "tree") == 0) broadphase = PhysicsScene::BroadphaseType::AABBTree;
+	else if (strcmp(pName, "brute") == 0) broadphase = PhysicsScene::BroadphaseType::BruteForce;
+	else return false;
+
+	return true;
+}
+
+int main(int argc, char* argv[])
+{
+	ScalingBenchmarkSettings settings;
+	const char* pOutputPath = nullptr;
+
+	for (int i = 1; i < argc; i++)
+	{
+		bool hasValue = i + 1 < argc;
+
+		if (strcmp(argv[i], "--help") == 0) {
+			PrintUsage();
+			return 0;
+		}
+		else if (strcmp(argv[i], "--narrowphase") == 0) {
+			RunNarrowphaseBenchmark();
+			return 0;
+		}
+		else if (strcmp(argv[i], "--scenario") == 0 && hasValue) {
+			settings.pScenario = argv[++i];
+		}
+		else if (strcmp(argv[i], "--broadphase") == 0 && hasValue && ParseBroadphase(argv[i + 1], settings.broadphase)) {
+			i++;
+		}
+		else if (strcmp(argv[i], "--bodies") == 0 && i + 2 < argc) {
+			settings.minBodyCount = strtoul(argv[++i], nullptr, 10);
+			settings.maxBodyCount = strtoul(argv[++i], nullptr, 10);
+		}
+		else if (strcmp(argv[i], "--threads") == 0 && hasValue) {
+			settings.maxThreadCount = strtoul(argv[++i], nullptr, 10);
+		}
+		else if (strcmp(argv[i], "--scenes") == 0 && hasValue) {
+			settings.sceneCount = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--steps") == 0 && hasValue) {
+			settings.stepCount = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--output") == 0 && hasValue) {
+			pOutputPath = argv[++i];
+		}
+		else if (strcmp(argv[i], "--trace") == 0 && hasValue) {
+			settings.pTracePath = argv[++i];
+		}
+		else {
+			PrintUsage();
+			return 1;
+		}
+	}
+
+	if (settings.minBodyCount == 0 || settings.minBodyCount > settings.maxBodyCount || settings.sceneCount < 1) {
+		PrintUsage();
+		return 1;
+	}
+
+	FILE* pOutput = stdout;
+	if (pOutputPath != nullptr) {
+		pOutput = fopen(pOutputPath, "w");
+		if (pOutput == nullptr) {
+			fprintf(stderr, "Couldn't open %s\n", pOutputPath);
+			return 1;
+		}
+	}
+
+	bool isScenarioFound = RunScalingBenchmark(settings, pOutput);
+	if (pOutput != stdout) {
+		fclose(pOutput);
+	}
+
+	if (!isScenarioFound) {
+		fprintf(stderr, "No scenario named %s\n", settings.pScenario);
+		PrintUsage();
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,385 @@
+#include "BodyStore.h"
+
+#include "RigidBody.h"
+
+#include <algorithm>
+
+
+const uint32_t BodyStore::DefaultCollisionLayers;
+const uint32_t BodyStore::DefaultCollisionMask;
+
+
+BodyHandle BodyStore::Add(glm::vec3 position, Shape* pShape, const RigidBody* pRigidBody)
+{
+	if (pRigidBody == nullptr) {
+		return Add(position, pShape, MotionType::Static, glm::vec3(0), 0);
+	}
+	return Add(position, pShape, MotionType::Dynamic, pRigidBody->GetVelocity(), 1 / pRigidBody->GetMass());
+}
+
+BodyHandle BodyStore::AddKinematic(glm::vec3 position, Shape* pShape, glm::vec3 velocity)
+{
+	return Add(position, pShape, MotionType::Kinematic, velocity, 0);
+}
+
+BodyHandle BodyStore::Add(glm::vec3 position, Shape* pShape, MotionType motionType, glm::vec3 velocity, float inverseMass)
+{
+	size_t index = m_positions.size();
+	BodyHandle handle = m_handleTable.Create(static_cast<uint32_t>(index));
+	m_handles.push_back(handle);
+
+	m_positions.push_back(position);
+	m_previousPositions.push_back(position);
+	m_velocities.push_back(velocity);
+	m_forces.push_back(glm::vec3(0));
+	m_inverseMasses.push_back(inverseMass);
+	m_ages.push_back(0);
+
+	m_isAwake.push_back(motionType == MotionType::Static ? 0 : 1);
+	m_restFrames.push_back(0);
+	m_islandIds.push_back(0);
+
+	m_collisionLayers.push_back(DefaultCollisionLayers);
+	m_collisionMasks.push_back(DefaultCollisionMask);
+
+	// The bounds of a shape at the origin reach out to its half extents
+	m_halfExtents.push_back(pShape->GetBounds(glm::vec3(0)).max);
+	m_shapeIDs.push_back(pShape->GetID());
+	m_pShapes.push_back(pShape);
+
+	// Added after the dynamic bodies, it's swapped with the first body of each partition
+	//   after its own until it reaches the end of its partition
+	for (int partition = static_cast<int>(MotionType::Count) - 1; partition > static_cast<int>(motionType); partition--)
+	{
+		size_t partitionBegin = m_partitionEnds[partition - 1];
+		Swap(index, partitionBegin);
+		index = partitionBegin;
+		m_partitionEnds[partition]++;
+	}
+	m_partitionEnds[static_cast<int>(motionType)]++;
+
+	return handle;
+}
+
+void BodyStore::AddDynamic(size_t count, const glm::vec3* pPositions, Shape* const* ppShapes, const float* pMasses, const glm::vec3* pVelocities)
+{
+	// Dynamic bodies are the last partition, so nothing needs swapping and each array
+	//   grows once rather than once per body
+	size_t begin = m_positions.size();
+	size_t end = begin + count;
+
+	m_handles.resize(end);
+	for (size_t i = begin; i < end; i++)
+	{
+		m_handles[i] = m_handleTable.Create(static_cast<uint32_t>(i));
+	}
+
+	m_positions.insert(m_positions.end(), pPositions, pPositions + count);
+	m_previousPositions.insert(m_previousPositions.end(), pPositions, pPositions + count);
+	m_velocities.insert(m_velocities.end(), pVelocities, pVelocities + count);
+	m_forces.resize(end, glm::vec3(0));
+	m_inverseMasses.resize(end);
+	m_ages.resize(end, 0);
+
+	m_isAwake.resize(end, 1);
+	m_restFrames.resize(end, 0);
+	m_islandIds.resize(end, 0);
+
+	m_collisionLayers.resize(end, DefaultCollisionLayers);
+	m_collisionMasks.resize(end, DefaultCollisionMask);
+
+	m_halfExtents.resize(end);
+	m_shapeIDs.resize(end);
+	m_pShapes.resize(end);
+	for (size_t i = 0; i < count; i++)
+	{
+		m_inverseMasses[begin + i] = 1 / pMasses[i];
+		m_halfExtents[begin + i] = ppShapes[i]->GetBounds(glm::vec3(0)).max;
+		m_shapeIDs[begin + i] = ppShapes[i]->GetID();
+		m_pShapes[begin + i] = ppShapes[i];
+	}
+
+	m_partitionEnds[static_cast<int>(MotionType::Dynamic)] += count;
+}
+
+void BodyStore::Remove(BodyHandle handle)
+{
+	size_t index = GetIndex(handle);
+
+	// Swapped with the last body of its partition, then of each partition after it, until
+	//   it's the last body and can be popped
+	for (int partition = static_cast<int>(GetMotionType(handle)); partition < static_cast<int>(MotionType::Count); partition++)
+	{
+		size_t partitionLast = m_partitionEnds[partition] - 1;
+		Swap(index, partitionLast);
+		index = partitionLast;
+		m_partitionEnds[partition]--;
+	}
+
+	m_handleTable.Destroy(handle);
+	m_shapePool.Destroy(m_pShapes.back());
+
+	m_handles.pop_back();
+	m_positions.pop_back();
+	m_previousPositions.pop_back();
+	m_velocities.pop_back();
+	m_forces.pop_back();
+	m_inverseMasses.pop_back();
+	m_ages.pop_back();
+	m_isAwake.pop_back();
+	m_restFrames.pop_back();
+	m_islandIds.pop_back();
+	m_collisionLayers.pop_back();
+	m_collisionMasks.pop_back();
+	m_halfExtents.pop_back();
+	m_shapeIDs.pop_back();
+	m_pShapes.pop_back();
+}
+
+void BodyStore::Swap(size_t index1, size_t index2)
+{
+	if (index1 == index2) return;
+
+	m_handleTable.Move(m_handles[index1], static_cast<uint32_t>(index2));
+	m_handleTable.Move(m_handles[index2], static_cast<uint32_t>(index1));
+
+	std::swap(m_handles[index1], m_handles[index2]);
+	std::swap(m_positions[index1], m_positions[index2]);
+	std::swap(m_previousPositions[index1], m_previousPositions[index2]);
+	std::swap(m_velocities[index1], m_velocities[index2]);
+	std::swap(m_forces[index1], m_forces[index2]);
+	std::swap(m_inverseMasses[index1], m_inverseMasses[index2]);
+	std::swap(m_ages[index1], m_ages[index2]);
+	std::swap(m_isAwake[index1], m_isAwake[index2]);
+	std::swap(m_restFrames[index1], m_restFrames[index2]);
+	std::swap(m_islandIds[index1], m_islandIds[index2]);
+	std::swap(m_collisionLayers[index1], m_collisionLayers[index2]);
+	std::swap(m_collisionMasks[index1], m_collisionMasks[index2]);
+	std::swap(m_halfExtents[index1], m_halfExtents[index2]);
+	std::swap(m_shapeIDs[index1], m_shapeIDs[index2]);
+	std::swap(m_pShapes[index1], m_pShapes[index2]);
+}
+
+BodyStore::MotionType BodyStore::GetMotionType(BodyHandle handle) const
+{
+	size_t index = GetIndex(handle);
+	if (index < GetPartitionEnd(MotionType::Static)) return MotionType::Static;
+	if (index < GetPartitionEnd(MotionType::Kinematic)) return MotionType::Kinematic;
+	return MotionType::Dynamic;
+}
+
+void BodyStore::Reserve(size_t count)
+{
+	m_handles.reserve(count);
+	m_positions.reserve(count);
+	m_previousPositions.reserve(count);
+	m_velocities.reserve(count);
+	m_forces.reserve(count);
+	m_inverseMasses.reserve(count);
+	m_ages.reserve(count);
+	m_isAwake.reserve(count);
+	m_restFrames.reserve(count);
+	m_islandIds.reserve(count);
+	m_collisionLayers.reserve(count);
+	m_collisionMasks.reserve(count);
+	m_halfExtents.reserve(count);
+	m_shapeIDs.reserve(count);
+	m_pShapes.reserve(count);
+}
+
+void BodyStore::SetCollisionFilter(BodyHandle handle, uint32_t layers, uint32_t mask)
+{
+	size_t index = GetIndex(handle);
+	m_collisionLayers[index] = layers;
+	m_collisionMasks[index] = mask;
+}
+
+void BodyStore::SetKinematicVelocity(BodyHandle handle, glm::vec3 velocity)
+{
+	if (GetMotionType(handle) != MotionType::Kinematic) return;
+
+	m_velocities[GetIndex(handle)] = velocity;
+}
+
+void BodyStore::AddVelocity(BodyHandle handle, glm::vec3 velocity)
+{
+	if (GetInverseMass(handle) == 0) return;
+
+	Wake(handle);
+	m_velocities[GetIndex(handle)] += velocity;
+}
+
+void BodyStore::AddForce(BodyHandle handle, glm::vec3 force)
+{
+	if (GetInverseMass(handle) == 0) return;
+
+	Wake(handle);
+	m_forces[GetIndex(handle)] += force;
+}
+
+void BodyStore::Wake(BodyHandle handle)
+{
+	size_t index = GetIndex(handle);
+	if (m_isAwake[index] || m_inverseMasses[index] == 0) return;
+
+	m_isAwake[index] = 1;
+	m_restFrames[index] = 0;
+	m_wokenHandles.push_back(handle);
+}
+
+void BodyStore::Sleep(size_t index, uint32_t islandId)
+{
+	m_isAwake[index] = 0;
+	m_islandIds[index] = islandId;
+	m_velocities[index] = glm::vec3(0);
+	m_forces[index] = glm::vec3(0);
+}
+
+void BodyStore::WakeIslands(std::vector<BodyHandle>& wokenHandles)
+{
+	if (m_wokenHandles.empty()) return;
+
+	m_wokenIslandIds.clear();
+	for (BodyHandle handle : m_wokenHandles)
+	{
+		// Could have been removed since it was woken
+		if (!IsValid(handle)) continue;
+
+		m_wokenIslandIds.push_back(m_islandIds[GetIndex(handle)]);
+		wokenHandles.push_back(handle);
+	}
+	m_wokenHandles.clear();
+
+	std::sort(std::begin(m_wokenIslandIds), std::end(m_wokenIslandIds));
+	m_wokenIslandIds.erase(std::unique(std::begin(m_wokenIslandIds), std::end(m_wokenIslandIds)), std::end(m_wokenIslandIds));
+
+	for (size_t i = GetPartitionBegin(MotionType::Dynamic); i < GetCount(); i++)
+	{
+		if (m_isAwake[i]) continue;
+		if (!std::binary_search(std::begin(m_wokenIslandIds), std::end(m_wokenIslandIds), m_islandIds[i])) continue;
+
+		m_isAwake[i] = 1;
+		m_restFrames[i] = 0;
+		wokenHandles.push_back(m_handles[i]);
+	}
+}
+
+void BodyStore::Save(SnapshotWriter& writer) const
+{
+	m_handleTable.Save(writer);
+	for (size_t partitionEnd : m_partitionEnds)
+	{
+		writer.Write(static_cast<uint64_t>(partitionEnd));
+	}
+
+	writer.WriteArray(m_handles);
+	writer.WriteArray(m_positions);
+	writer.WriteArray(m_previousPositions);
+	writer.WriteArray(m_velocities);
+	writer.WriteArray(m_forces);
+	writer.WriteArray(m_inverseMasses);
+	writer.WriteArray(m_ages);
+	writer.WriteArray(m_isAwake);
+	writer.WriteArray(m_restFrames);
+	writer.WriteArray(m_islandIds);
+	writer.WriteArray(m_wokenHandles);
+	writer.WriteArray(m_collisionLayers);
+	writer.WriteArray(m_collisionMasks);
+	writer.WriteArray(m_halfExtents);
+	writer.WriteArray(m_shapeIDs);
+
+	std::vector<PlaneParams> planes;
+	for (size_t i = 0; i < GetCount(); i++)
+	{
+		if (m_shapeIDs[i] != static_cast<int>(Shape::ID::Plane)) continue;
+
+		const Plane* pPlane = static_cast<const Plane*>(m_pShapes[i]);
+		planes.push_back(PlaneParams{ static_cast<uint32_t>(i), pPlane->GetNormal(), pPlane->GetDistance() });
+	}
+	writer.WriteArray(planes);
+}
+
+bool BodyStore::Restore(SnapshotReader& reader)
+{
+	// Read into a new store, so this one is only replaced once the whole snapshot has been read
+	BodyStore store;
+	if (!store.m_handleTable.Restore(reader)) return false;
+
+	size_t partitionBegin = 0;
+	for (size_t& partitionEnd : store.m_partitionEnds)
+	{
+		uint64_t end;
+		if (!reader.Read(end) || end < partitionBegin) return false;
+		partitionEnd = static_cast<size_t>(end);
+		partitionBegin = partitionEnd;
+	}
+
+	const size_t count = partitionBegin;
+	if (!reader.ReadArray(store.m_handles, count) ||
+		!reader.ReadArray(store.m_positions, count) ||
+		!reader.ReadArray(store.m_previousPositions, count) ||
+		!reader.ReadArray(store.m_velocities, count) ||
+		!reader.ReadArray(store.m_forces, count) ||
+		!reader.ReadArray(store.m_inverseMasses, count) ||
+		!reader.ReadArray(store.m_ages, count) ||
+		!reader.ReadArray(store.m_isAwake, count) ||
+		!reader.ReadArray(store.m_restFrames, count) ||
+		!reader.ReadArray(store.m_islandIds, count) ||
+		!reader.ReadArray(store.m_wokenHandles) ||
+		!reader.ReadArray(store.m_collisionLayers, count) ||
+		!reader.ReadArray(store.m_collisionMasks, count) ||
+		!reader.ReadArray(store.m_halfExtents, count) ||
+		!reader.ReadArray(store.m_shapeIDs, count)) {
+		return false;
+	}
+
+	size_t planeCount;
+	const PlaneParams* planes = reader.ReadArray<PlaneParams>(planeCount);
+	if (planes == nullptr) return false;
+
+	// Every body's handle has to lead back to it, and every live handle has to have a body
+	if (store.m_handleTable.GetLiveCount() != count) return false;
+	for (size_t i = 0; i < count; i++)
+	{
+		BodyHandle handle = store.m_handles[i];
+		if (!store.m_handleTable.IsValid(handle) || store.m_handleTable.GetDenseIndex(handle) != i) return false;
+	}
+
+	// Woken bodies can have been removed since, but their slots have to exist
+	for (BodyHandle handle : store.m_wokenHandles)
+	{
+		if (handle.index >= store.m_handleTable.GetSlotCount()) return false;
+	}
+
+	store.m_pShapes.resize(count);
+	for (size_t i = 0; i < planeCount; i++)
+	{
+		const PlaneParams& plane = planes[i];
+		if (plane.index >= count || store.m_shapeIDs[plane.index] != static_cast<int>(Shape::ID::Plane)) return false;
+		if (store.m_pShapes[plane.index] != nullptr) return false;
+
+		store.m_pShapes[plane.index] = store.CreateShape<Plane>(plane.normal, plane.distance);
+	}
+
+	for (size_t i = 0; i < count; i++)
+	{
+		switch (static_cast<Shape::ID>(store.m_shapeIDs[i]))
+		{
+		case Shape::ID::Sphere:
+			// A sphere's half extents are its radius
+			store.m_pShapes[i] = store.CreateShape<Sphere>(store.m_halfExtents[i].x);
+			break;
+		case Shape::ID::AABB:
+			store.m_pShapes[i] = store.CreateShape<AABB>(store.m_halfExtents[i]);
+			break;
+		case Shape::ID::Plane:
+			if (store.m_pShapes[i] == nullptr) return false;
+			break;
+		default:
+			return false;
+		}
+	}
+
+	*this = std::move(store);
+	return true;
+}
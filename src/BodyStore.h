@@ -0,0 +1,166 @@
+#pragma once
+
+#include "Bounds.h"
+#include "HandleTable.h"
+#include "ShapePool.h"
+#include "Shapes.h"
+#include "Snapshot.h"
+
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+class RigidBody;
+
+
+// Keeps the state of every body in a scene in contiguous arrays, so the per step loops
+//   run linearly through memory rather than chasing a pointer per body.
+// Removing a body moves the last body into its place, so the arrays stay packed. Handles
+//   stay valid across this, indexes into the arrays don't.
+// The arrays are split into static, then kinematic, then dynamic bodies, so each loop only
+//   runs over the bodies it can affect. Static and kinematic bodies have an inverse mass of zero.
+class BodyStore
+{
+public:
+	// Static bodies never move, kinematic bodies move at their velocity without being pushed
+	//   by anything, dynamic bodies are moved by forces and collisions.
+	enum class MotionType { Static, Kinematic, Dynamic, Count };
+
+	// Collide with everything by default
+	static const uint32_t DefaultCollisionLayers = 1;
+	static const uint32_t DefaultCollisionMask = UINT32_MAX;
+
+	// Shapes are made in the store's pool, and go back to it when their body is removed
+	template<typename T, typename... Args>
+	T* CreateShape(Args&&... args) { return m_shapePool.Create<T>(std::forward<Args>(args)...); }
+	PoolStats GetShapePoolStats() const { return m_shapePool.GetStats(); }
+
+	// The shape must come from CreateShape. Bodies without a rigid body are static.
+	BodyHandle Add(glm::vec3 position, Shape* pShape, const RigidBody* pRigidBody = nullptr);
+	BodyHandle AddKinematic(glm::vec3 position, Shape* pShape, glm::vec3 velocity);
+	// Adds count dynamic bodies to the end of the arrays, the shapes must come from CreateShape.
+	// Their handles are the last count in GetHandles().
+	void AddDynamic(size_t count, const glm::vec3* pPositions, Shape* const* ppShapes, const float* pMasses, const glm::vec3* pVelocities);
+	void Remove(BodyHandle handle);
+	void Reserve(size_t count);
+
+	// The range of indexes holding the bodies of a motion type
+	size_t GetPartitionBegin(MotionType motionType) const { return motionType == MotionType::Static ? 0 : m_partitionEnds[static_cast<int>(motionType) - 1]; }
+	size_t GetPartitionEnd(MotionType motionType) const { return m_partitionEnds[static_cast<int>(motionType)]; }
+	MotionType GetMotionType(BodyHandle handle) const;
+
+	bool IsValid(BodyHandle handle) const { return m_handleTable.IsValid(handle); }
+	size_t GetCount() const { return m_positions.size(); }
+	size_t GetIndex(BodyHandle handle) const { return m_handleTable.GetDenseIndex(handle); }
+
+	// The live handle in a slot, slots are what the broadphase uses as ids
+	BodyHandle GetHandleFromSlot(uint32_t slot) const { return m_handleTable.GetHandle(slot); }
+
+	glm::vec3 GetPosition(BodyHandle handle) const { return m_positions[GetIndex(handle)]; }
+	glm::vec3 GetVelocity(BodyHandle handle) const { return m_velocities[GetIndex(handle)]; }
+	float GetInverseMass(BodyHandle handle) const { return m_inverseMasses[GetIndex(handle)]; }
+	const Shape* GetShape(BodyHandle handle) const { return m_pShapes[GetIndex(handle)]; }
+	bool IsStatic(BodyHandle handle) const { return GetIndex(handle) < GetPartitionEnd(MotionType::Static); }
+
+	// Model static and kinematic objects as objects with a very large mass
+	float GetMass(BodyHandle handle) const {
+		return GetInverseMass(handle) == 0 ? std::numeric_limits<float>::max() : 1 / GetInverseMass(handle);
+	}
+
+	// Two bodies can collide if each is on a layer in the other's mask
+	void SetCollisionFilter(BodyHandle handle, uint32_t layers, uint32_t mask);
+	bool CanCollide(size_t index1, size_t index2) const {
+		return (m_collisionLayers[index1] & m_collisionMasks[index2]) != 0 && (m_collisionLayers[index2] & m_collisionMasks[index1]) != 0;
+	}
+
+	Bounds GetBounds(BodyHandle handle) const { return GetBoundsAt(GetIndex(handle)); }
+	Bounds GetBoundsAt(size_t index) const {
+		return Bounds{ m_positions[index] - m_halfExtents[index], m_positions[index] + m_halfExtents[index] };
+	}
+
+	void Translate(BodyHandle handle, glm::vec3 positionDelta) { m_positions[GetIndex(handle)] += positionDelta; }
+	void AddVelocity(BodyHandle handle, glm::vec3 velocity);
+	void AddForce(BodyHandle handle, glm::vec3 force);
+	void Stop(BodyHandle handle) { m_velocities[GetIndex(handle)] = glm::vec3(0); }
+	// Only kinematic bodies, the velocity of dynamic bodies comes from forces and collisions
+	void SetKinematicVelocity(BodyHandle handle, glm::vec3 velocity);
+
+	// Dynamic bodies that have been at rest for a while are put to sleep, along with the rest
+	//   of their island, see PhysicsScene. Static bodies are never awake, kinematic bodies always are.
+	bool IsAwake(BodyHandle handle) const { return m_isAwake[GetIndex(handle)] != 0; }
+	// Does nothing for static and kinematic bodies. The rest of the body's island wakes on the next WakeIslands.
+	void Wake(BodyHandle handle);
+	// Bodies put to sleep together share an island id
+	void Sleep(size_t index, uint32_t islandId);
+	// Wakes every body sharing an island with a body woken since the last call.
+	// Appends the handles of all the woken bodies.
+	void WakeIslands(std::vector<BodyHandle>& wokenHandles);
+
+	// Keeps a copy of the positions from before a step, for interpolating between steps
+	void SavePreviousPositions() { m_previousPositions = m_positions; }
+
+	// Writes every array and the handle table, so handles stay valid across a restore.
+	// Restore copies each array whole out of the snapshot, only the shapes are made one by one.
+	// Leaves the store unchanged and returns false if the snapshot is broken.
+	void Save(SnapshotWriter& writer) const;
+	bool Restore(SnapshotReader& reader);
+
+	// Arrays for the per step loops, each is GetCount() long
+	const BodyHandle* GetHandles() const { return m_handles.data(); }
+	glm::vec3* GetPositions() { return m_positions.data(); }
+	const glm::vec3* GetPreviousPositions() const { return m_previousPositions.data(); }
+	glm::vec3* GetVelocities() { return m_velocities.data(); }
+	glm::vec3* GetForces() { return m_forces.data(); }
+	float* GetAges() { return m_ages.data(); }
+	const float* GetInverseMasses() const { return m_inverseMasses.data(); }
+	const glm::vec3* GetHalfExtents() const { return m_halfExtents.data(); }
+	const int* GetShapeIDs() const { return m_shapeIDs.data(); }
+	const uint8_t* GetAwakeFlags() const { return m_isAwake.data(); }
+	const uint32_t* GetCollisionLayers() const { return m_collisionLayers.data(); }
+	uint16_t* GetRestFrames() { return m_restFrames.data(); }
+
+private:
+	BodyHandle Add(glm::vec3 position, Shape* pShape, MotionType motionType, glm::vec3 velocity, float inverseMass);
+	// Swaps every array, and the handles pointing at them
+	void Swap(size_t index1, size_t index2);
+
+	// Planes are the only shapes that need more than their half extents to be made again
+	struct PlaneParams
+	{
+		uint32_t index;
+		glm::vec3 normal;
+		float distance;
+	};
+
+	HandleTable m_handleTable;
+	// One past the last index of each motion type
+	size_t m_partitionEnds[static_cast<int>(MotionType::Count)] = {};
+	std::vector<BodyHandle> m_handles;
+
+	// Per step data
+	std::vector<glm::vec3> m_positions;
+	std::vector<glm::vec3> m_previousPositions;
+	std::vector<glm::vec3> m_velocities;
+	std::vector<glm::vec3> m_forces;
+	std::vector<float> m_inverseMasses;
+	std::vector<float> m_ages; // Seconds since the body was added
+
+	// Sleeping
+	std::vector<uint8_t> m_isAwake;
+	std::vector<uint16_t> m_restFrames; // Steps in a row spent below the sleep velocity
+	std::vector<uint32_t> m_islandIds;
+	std::vector<BodyHandle> m_wokenHandles;
+	std::vector<uint32_t> m_wokenIslandIds;
+
+	std::vector<uint32_t> m_collisionLayers;
+	std::vector<uint32_t> m_collisionMasks;
+
+	// Shape parameters, half extents of the bounds around the body's position
+	std::vector<glm::vec3> m_halfExtents;
+	std::vector<int> m_shapeIDs;
+
+	// Only needed by the narrowphase and for drawing
+	ShapePool m_shapePool;
+	std::vector<Shape*> m_pShapes;
+};
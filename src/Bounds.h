@@ -0,0 +1,27 @@
+#pragma once
+
+#include <glm/vec3.hpp>
+
+#include <limits>
+
+// An axis aligned bounding volume in world space.
+// This is separate from the AABB shape, any shape can report the space it covers.
+struct Bounds
+{
+	glm::vec3 min;
+	glm::vec3 max;
+
+	bool Overlaps(const Bounds& other) const
+	{
+		return min.x <= other.max.x && max.x >= other.min.x &&
+			min.y <= other.max.y && max.y >= other.min.y &&
+			min.z <= other.max.z && max.z >= other.min.z;
+	}
+
+	// Used for shapes like planes that divide all of space
+	static Bounds Infinite()
+	{
+		const float maxValue = std::numeric_limits<float>::max();
+		return Bounds{ glm::vec3(-maxValue), glm::vec3(maxValue) };
+	}
+};
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "Bounds.h"
+
+#include <cstdint>
+#include <vector>
+
+// A pair of bodies whose bounds overlap, id1 is always less than id2.
+struct BroadphasePair
+{
+	uint32_t id1;
+	uint32_t id2;
+
+	uint64_t GetKey() const { return (static_cast<uint64_t>(id1) << 32) | id2; }
+};
+
+
+// Finds the pairs of bodies that may be colliding so the narrowphase can skip the rest.
+// Bodies are identified by an id chosen by the scene, an id can be added again once removed.
+class Broadphase
+{
+public:
+	virtual ~Broadphase() {}
+
+	virtual void Add(uint32_t id, const Bounds& bounds, bool isStatic) = 0;
+	virtual void Remove(uint32_t id) = 0;
+	virtual void Update(uint32_t id, const Bounds& bounds) = 0;
+	// Sleeping bodies don't move, so they're made static until they wake
+	virtual void SetStatic(uint32_t id, bool isStatic) = 0;
+
+	// Appends the overlapping pairs, pairs of two static bodies are never reported.
+	virtual void FindPairs(std::vector<BroadphasePair>& pairs) = 0;
+};
@@ -1,20 +1,13 @@
 #include "Collision.h"
 
+#include "CollisionDispatch.h"
 #include "PhysicsObject.h"
 #include "Shapes.h"
 
 
-#include <assert.h>
-#include <glm\glm.hpp>
-
-
-const std::array<CollisionDetectionFunction,9> Collision::CollisionDetectionFunctions
-{
-	PlaneToPlane,	PlaneToSphere,	PlaneToAABB,
-	SphereToPlane,	SphereToSphere,	SphereToAABB,
-	AABBToPlane,	AABBToSphere,	AABBToAABB
-};
-
+#include <algorithm>
+#include <cmath>
+#include <glm/glm.hpp>
 
 
 void Separate( PhysicsObject* pObject1, PhysicsObject* pObject2, float overlap, glm::vec3 normal )
@@ -42,196 +35,329 @@ void Response( PhysicsObject* pObject1, PhysicsObject* pObject2, float overlap,
 
     glm::vec3 impulse = impulseAmount * normal;
     pObject1->AddVelocity(1 / pObject1->GetMass() * -impulse);
-    pObject1->AddVelocity(1 / pObject2->GetMass() * +impulse);
+    pObject2->AddVelocity(1 / pObject2->GetMass() * +impulse);
 }
 
 
 bool Collision::Detect(PhysicsObject* pObject1, PhysicsObject* pObject2)
 {
-	int shapeID1 = pObject1->GetShape()->GetID();
-	int shapeID2 = pObject2->GetShape()->GetID();
-
-	// Get the index of the collision function
-	int collisionFunctionIndex = shapeID1 * Shape::GetShapeCount() + shapeID2;
-	assert(static_cast<size_t>(collisionFunctionIndex) < CollisionDetectionFunctions.size());
-
-	// Call the collison function
-	CollisionDetectionFunction collisionFunction = CollisionDetectionFunctions[collisionFunctionIndex];
-	if (collisionFunction != nullptr) {
-		return collisionFunction(pObject1, pObject2);
+	Contact contact;
+	if (FindContact(pObject1, pObject2, contact)) {
+		// The contact can have the bodies the other way around
+		bool isSwapped = contact.handle1 != pObject1->GetHandle();
+		Response(isSwapped ? pObject2 : pObject1, isSwapped ? pObject1 : pObject2, contact.overlap, contact.normal);
+		return true;
 	}
 
 	return false;
 }
 
-
-// ---- Point Collisions ----
-bool Collision::PointToPlane(glm::vec3 point, const Plane* pPlane)
+bool Collision::FindContact(PhysicsObject* pObject1, PhysicsObject* pObject2, Contact& contact)
 {
-	return glm::dot(point, pPlane->GetNormal()) < 0;
+	return ShapePairDispatch<CollisionShapes>::FindContact(pObject1->GetShape()->GetID(), pObject2->GetShape()->GetID(), pObject1, pObject2, contact);
 }
 
-
-// ----- Plane collisions -----
-bool Collision::PlaneToSphere(PhysicsObject* pPlaneObject, PhysicsObject* pSphereObject)
+bool Collision::SweepSphere(glm::vec3 start, glm::vec3 displacement, float radius,
+	PhysicsObject* pOther, glm::vec3 otherDisplacement, float& timeOfImpact)
 {
-	const auto pSphere = pSphereObject->GetShape<Sphere>();
-	const auto pPlane = pPlaneObject->GetShape<Plane>();
-
-	const glm::vec3 sphereVector = pSphereObject->GetPosition();
-	const glm::vec3 planeNormal = pPlane->GetNormal();
+	// Sweep in the other body's frame, as though it hadn't moved
+	glm::vec3 relativeDisplacement = displacement - otherDisplacement;
+	glm::vec3 otherStart = pOther->GetPosition() - otherDisplacement;
 
-	// Where does the sphere center point overlap the plane normal
-	float sphereDistanceAlongPlaneNormal = glm::dot(sphereVector, planeNormal);
-
-	// If the plane distane and sphere radius are bigger then the distance along the normal
-	//   then we overlap.
-	float overlap = sphereDistanceAlongPlaneNormal - (pPlane->GetDistance() + pSphere->GetRadius());
-	if (overlap < 0)
+	switch (static_cast<Shape::ID>(pOther->GetShape()->GetID()))
 	{
-		Response(pPlaneObject, pSphereObject, -overlap, planeNormal);
-		return true;
+	case Shape::ID::Plane:
+		return SweepSphereToPlane(start, displacement, radius, pOther->GetShape<Plane>(), timeOfImpact);
+	case Shape::ID::Sphere:
+		return SweepSphereToSphere(start, relativeDisplacement, radius, otherStart, pOther->GetShape<Sphere>()->GetRadius(), timeOfImpact);
+	case Shape::ID::AABB:
+		return SweepSphereToAABB(start, relativeDisplacement, radius, otherStart, pOther->GetShape<AABB>()->GetExtents(), timeOfImpact);
+	default:
+		return false;
 	}
-
-	return false;
 }
 
-bool Collision::PlaneToAABB(PhysicsObject* pPlaneObject, PhysicsObject* pAABBObject)
+bool Collision::SweepSphereToPlane(glm::vec3 start, glm::vec3 displacement, float radius, const Plane* pPlane, float& timeOfImpact)
 {
-	const auto pPlane = pPlaneObject->GetShape<Plane>();
-	const auto pAABB = pAABBObject->GetShape<AABB>();
-
-	glm::vec3 AABBPos = pAABBObject->GetPosition();
-	glm::vec3 minPos = AABBPos - pAABB->GetExtents();
-	glm::vec3 maxPos = AABBPos + pAABB->GetExtents();
-
-	float minPointDistanceAlongPlaneNormal = glm::dot(minPos, pPlane->GetNormal());
-	float maxPointDistanceAlongPlaneNormal = glm::dot(maxPos, pPlane->GetNormal());
+	// Height of the sphere center above the plane, at the start and end of the step
+	float startDistance = glm::dot(start, pPlane->GetNormal()) - pPlane->GetDistance();
+	float endDistance = startDistance + glm::dot(displacement, pPlane->GetNormal());
 
-	float overlap = std::min(minPointDistanceAlongPlaneNormal, maxPointDistanceAlongPlaneNormal);
+	if (startDistance <= radius || endDistance >= radius) return false;
 
-	if(overlap < 0 ) {
-		Response(pPlaneObject, pAABBObject, -overlap, pPlane->GetNormal());
-		return true;
-	}
-
-	return false;
+	timeOfImpact = (startDistance - radius) / (startDistance - endDistance);
+	return true;
 }
 
-bool Collision::PlaneToPlane(PhysicsObject* pPlaneObject1, PhysicsObject* pPlaneObject2)
+bool Collision::SweepSphereToSphere(glm::vec3 start, glm::vec3 displacement, float radius, glm::vec3 otherStart, float otherRadius, float& timeOfImpact)
 {
-    // Not going to implement this right now.
-	return false;
-}
+	// Solve |offset + displacement * t| = radiusSum for the first t
+	glm::vec3 offset = start - otherStart;
+	float radiusSum = radius + otherRadius;
 
-// ----- Sphere Collisions ----
-bool Collision::SphereToPlane(PhysicsObject* pSphereObject, PhysicsObject* pPlaneObject)
-{
-	return PlaneToSphere( pPlaneObject, pSphereObject );
-}
+	float a = glm::dot(displacement, displacement);
+	float b = 2 * glm::dot(offset, displacement);
+	float c = glm::dot(offset, offset) - radiusSum * radiusSum;
 
-bool Collision::SphereToSphere(PhysicsObject* pSphereObject1, PhysicsObject* pSphereObject2)
-{
-	const auto pSphere1 = pSphereObject1->GetShape<Sphere>();
-	const auto pSphere2 = pSphereObject2->GetShape<Sphere>();
+	if (c <= 0 || a == 0) return false;
 
-	glm::vec3 directionVector = pSphereObject2->GetPosition() - pSphereObject1->GetPosition();
-	float centerDistance = glm::length(directionVector);
-	float radiusDistance = pSphere1->GetRadius() + pSphere2->GetRadius();
+	float discriminant = b * b - 4 * a * c;
+	if (discriminant < 0) return false;
 
-	float overlap = centerDistance - radiusDistance;
-	if (overlap < 0) {
-		Response(pSphereObject1, pSphereObject2, -overlap, glm::normalize(directionVector) );
-		return true;
-	}
+	float t = (-b - std::sqrt(discriminant)) / (2 * a);
+	if (t < 0 || t > 1) return false;
 
-	return false;
+	timeOfImpact = t;
+	return true;
 }
 
-bool Collision::SphereToAABB(PhysicsObject* pSphereObject, PhysicsObject* pAABBObject)
+bool Collision::SweepSphereToAABB(glm::vec3 start, glm::vec3 displacement, float radius, glm::vec3 otherStart, glm::vec3 extents, float& timeOfImpact)
 {
-    const auto pSphere = pSphereObject->GetShape<Sphere>();
-    const auto pAABB = pAABBObject->GetShape<AABB>();
-
-    glm::vec3 minPos = -pAABB->GetExtents();
-    glm::vec3 maxPos = pAABB->GetExtents();
-
-    glm::vec3 distance = pSphereObject->GetPosition() - pAABBObject->GetPosition();
-	glm::vec3 clampedPoint = distance;
+	// The sphere center against the box grown by the radius. The grown box has square corners
+	//   where it should be rounded, so a sphere just missing a corner can stop a little early.
+	glm::vec3 minPos = otherStart - extents - glm::vec3(radius);
+	glm::vec3 maxPos = otherStart + extents + glm::vec3(radius);
 
-    if (distance.x < minPos.x)
-        clampedPoint.x = minPos.x;
-    else if (distance.x > maxPos.x)
-        clampedPoint.x = maxPos.x;
+	float enter = 0;
+	float exit = 1;
+	bool isInside = true;
 
-    if (distance.y < minPos.y)
-        clampedPoint.y = minPos.y;
-    else if (distance.y > maxPos.y)
-        clampedPoint.y = maxPos.y;
+	// Slab test, one axis at a time
+	for (int axis = 0; axis < 3; axis++)
+	{
+		if (start[axis] < minPos[axis] || start[axis] > maxPos[axis]) {
+			isInside = false;
+		}
+
+		if (displacement[axis] == 0) {
+			if (start[axis] < minPos[axis] || start[axis] > maxPos[axis]) return false;
+			continue;
+		}
+
+		float t1 = (minPos[axis] - start[axis]) / displacement[axis];
+		float t2 = (maxPos[axis] - start[axis]) / displacement[axis];
+		enter = std::max(enter, std::min(t1, t2));
+		exit = std::min(exit, std::max(t1, t2));
+		if (enter > exit) return false;
+	}
 
-    if (distance.z < minPos.z)
-        clampedPoint.z = minPos.z;
-    else if (distance.z > maxPos.z)
-        clampedPoint.z = maxPos.z;
+	if (isInside) return false;
 
-    glm::vec3 clampedDistance = distance - clampedPoint;
+	timeOfImpact = enter;
+	return true;
+}
 
-    float overlap = glm::length(clampedDistance) - pSphere->GetRadius();
-    if (overlap < 0)
-    {
-        Response(pAABBObject, pSphereObject, -overlap, glm::normalize(clampedDistance));
-        return true;
-    }
 
-	return false;
+// ---- Scene Queries ----
+bool Collision::Raycast(const Shape* pShape, glm::vec3 position, glm::vec3 origin, glm::vec3 direction, float maxDistance, QueryHit& hit)
+{
+	switch (static_cast<Shape::ID>(pShape->GetID()))
+	{
+	case Shape::ID::Plane: {
+		const Plane* pPlane = static_cast<const Plane*>(pShape);
+		// Everything behind a plane is inside it
+		float startDistance = glm::dot(origin, pPlane->GetNormal()) - pPlane->GetDistance();
+		if (startDistance <= 0) {
+			SetStartHit(origin, direction, hit);
+			return true;
+		}
+
+		float speed = -glm::dot(direction, pPlane->GetNormal());
+		if (speed <= 0 || startDistance > speed * maxDistance) return false;
+
+		hit.distance = startDistance / speed;
+		hit.position = origin + direction * hit.distance;
+		hit.normal = pPlane->GetNormal();
+		return true;
+	}
+	case Shape::ID::Sphere: {
+		// Solve |offset + direction * t| = radius for the first t
+		float radius = static_cast<const Sphere*>(pShape)->GetRadius();
+		glm::vec3 offset = origin - position;
+		float b = glm::dot(offset, direction);
+		float c = glm::dot(offset, offset) - radius * radius;
+		if (c <= 0) {
+			SetStartHit(origin, direction, hit);
+			return true;
+		}
+		if (b > 0) return false;
+
+		float discriminant = b * b - c;
+		if (discriminant < 0) return false;
+
+		float t = -b - std::sqrt(discriminant);
+		if (t > maxDistance) return false;
+
+		hit.distance = t;
+		hit.position = origin + direction * t;
+		hit.normal = (hit.position - position) / radius;
+		return true;
+	}
+	case Shape::ID::AABB: {
+		int axis;
+		if (!RaycastAABB(origin, direction, maxDistance, position, static_cast<const AABB*>(pShape)->GetExtents(), hit.distance, axis)) return false;
+
+		if (axis < 0) {
+			SetStartHit(origin, direction, hit);
+			return true;
+		}
+		hit.position = origin + direction * hit.distance;
+		hit.normal = glm::vec3(0);
+		hit.normal[axis] = direction[axis] > 0 ? -1.0f : 1.0f;
+		return true;
+	}
+	default:
+		return false;
+	}
 }
 
-// ---- AABB Collisions ----
-bool Collision::AABBToPlane(PhysicsObject* pAABBObject, PhysicsObject* pPlaneObject)
+bool Collision::OverlapSphere(const Shape* pShape, glm::vec3 position, glm::vec3 center, float radius)
 {
-	return PlaneToAABB( pPlaneObject, pAABBObject );
+	switch (static_cast<Shape::ID>(pShape->GetID()))
+	{
+	case Shape::ID::Plane: {
+		const Plane* pPlane = static_cast<const Plane*>(pShape);
+		return glm::dot(center, pPlane->GetNormal()) - pPlane->GetDistance() <= radius;
+	}
+	case Shape::ID::Sphere: {
+		float radiusSum = radius + static_cast<const Sphere*>(pShape)->GetRadius();
+		glm::vec3 offset = center - position;
+		return glm::dot(offset, offset) <= radiusSum * radiusSum;
+	}
+	case Shape::ID::AABB: {
+		glm::vec3 extents = static_cast<const AABB*>(pShape)->GetExtents();
+		glm::vec3 offset = center - glm::clamp(center, position - extents, position + extents);
+		return glm::dot(offset, offset) <= radius * radius;
+	}
+	default:
+		return false;
+	}
 }
 
-bool Collision::AABBToSphere(PhysicsObject* pAABBObject, PhysicsObject* pSphereObject)
+bool Collision::SweepBox(const Shape* pShape, glm::vec3 position, glm::vec3 center, glm::vec3 extents, glm::vec3 direction, float maxDistance, QueryHit& hit)
 {
-	return SphereToAABB( pSphereObject, pAABBObject );
+	switch (static_cast<Shape::ID>(pShape->GetID()))
+	{
+	case Shape::ID::Plane: {
+		const Plane* pPlane = static_cast<const Plane*>(pShape);
+		// How far the box reaches towards the plane from its center
+		float reach = glm::dot(glm::abs(pPlane->GetNormal()), extents);
+		float startDistance = glm::dot(center, pPlane->GetNormal()) - pPlane->GetDistance() - reach;
+		if (startDistance <= 0) {
+			SetStartHit(center, direction, hit);
+			return true;
+		}
+
+		float speed = -glm::dot(direction, pPlane->GetNormal());
+		if (speed <= 0 || startDistance > speed * maxDistance) return false;
+
+		hit.distance = startDistance / speed;
+		hit.normal = pPlane->GetNormal();
+		hit.position = center + direction * hit.distance - hit.normal * reach;
+		return true;
+	}
+	case Shape::ID::Sphere:
+		return SweepBoxToSphere(center, extents, direction, maxDistance, position, static_cast<const Sphere*>(pShape)->GetRadius(), hit);
+	case Shape::ID::AABB: {
+		// The box's center against the other box grown by its extents
+		glm::vec3 otherExtents = static_cast<const AABB*>(pShape)->GetExtents();
+		int axis;
+		if (!RaycastAABB(center, direction, maxDistance, position, extents + otherExtents, hit.distance, axis)) return false;
+
+		if (axis < 0) {
+			SetStartHit(center, direction, hit);
+			return true;
+		}
+		hit.normal = glm::vec3(0);
+		hit.normal[axis] = direction[axis] > 0 ? -1.0f : 1.0f;
+		hit.position = glm::clamp(center + direction * hit.distance, position - otherExtents, position + otherExtents);
+		return true;
+	}
+	default:
+		return false;
+	}
 }
 
-bool Collision::AABBToAABB(PhysicsObject* pAABBObject1, PhysicsObject* pAABBObject2)
+bool Collision::RaycastAABB(glm::vec3 origin, glm::vec3 direction, float maxDistance, glm::vec3 center, glm::vec3 extents, float& distance, int& axis)
 {
-    const auto pAABB1 = pAABBObject1->GetShape<AABB>();
-    const auto pAABB2 = pAABBObject2->GetShape<AABB>();
-
-    glm::vec3 box1Pos = pAABBObject1->GetPosition();
-    glm::vec3 box1Extents = pAABB1->GetExtents();
-
-    glm::vec3 box2Pos = pAABBObject2->GetPosition();
-    glm::vec3 box2Extents = pAABB2->GetExtents();
+	glm::vec3 minPos = center - extents;
+	glm::vec3 maxPos = center + extents;
 
-	glm::vec3 boxDelta = box2Pos - box1Pos;
-	glm::vec3 boxExtentsCombined = box1Extents + box2Extents;
+	float enter = 0;
+	float exit = maxDistance;
+	axis = -1;
 
-    float xOverlap = std::abs(boxDelta.x) - boxExtentsCombined.x;
-    float yOverlap = std::abs(boxDelta.y) - boxExtentsCombined.y;
-    float zOverlap = std::abs(boxDelta.z) - boxExtentsCombined.z;
+	// Slab test, one axis at a time
+	for (int i = 0; i < 3; i++)
+	{
+		if (direction[i] == 0) {
+			if (origin[i] < minPos[i] || origin[i] > maxPos[i]) return false;
+			continue;
+		}
+
+		float t1 = (minPos[i] - origin[i]) / direction[i];
+		float t2 = (maxPos[i] - origin[i]) / direction[i];
+		float slabEnter = std::min(t1, t2);
+		if (slabEnter > enter) {
+			enter = slabEnter;
+			axis = i;
+		}
+		exit = std::min(exit, std::max(t1, t2));
+		if (enter > exit) return false;
+	}
 
+	distance = enter;
+	return true;
+}
 
-    if (xOverlap <= 0 && yOverlap <= 0 && zOverlap <= 0)
-    {
-        float minOverlap = xOverlap;
-        minOverlap = yOverlap < 0 ? std::max(minOverlap, yOverlap) : minOverlap;
-        minOverlap = zOverlap < 0 ? std::max(minOverlap, zOverlap) : minOverlap;
-        
-        glm::vec3 separationNormal(0);
+bool Collision::SweepBoxToSphere(glm::vec3 center, glm::vec3 extents, glm::vec3 direction, float maxDistance, glm::vec3 sphereCenter, float radius, QueryHit& hit)
+{
+	const int MaxIterations = 32;
+	const float Tolerance = 0.0001f;
+
+	// As though the box stood still and the sphere moved the other way. The box grown by the
+	//   radius has square corners where the real shape is rounded, so it gives where to start.
+	float distance;
+	int axis;
+	if (!RaycastAABB(sphereCenter, -direction, maxDistance, center, extents + glm::vec3(radius), distance, axis)) return false;
+
+	// Then the sphere is moved on by its distance from the box until it touches. It can't
+	//   get any closer than that in that distance, so it never moves past the box.
+	for (int i = 0; i < MaxIterations && distance <= maxDistance; i++)
+	{
+		glm::vec3 position = sphereCenter - direction * distance;
+		glm::vec3 closestPoint = glm::clamp(position, center - extents, center + extents);
+		glm::vec3 offset = closestPoint - position;
+		float gap = std::sqrt(glm::dot(offset, offset)) - radius;
+
+		if (gap <= Tolerance) {
+			if (distance == 0) {
+				SetStartHit(center, direction, hit);
+				return true;
+			}
+
+			// Back where the box really is, it moved rather than the sphere
+			hit.distance = distance;
+			hit.normal = glm::normalize(offset);
+			hit.position = closestPoint + direction * distance;
+			return true;
+		}
+		distance += gap;
+	}
 
-        if (xOverlap == minOverlap) separationNormal.x = std::signbit(boxDelta.x) ? -1.f : 1.f;
-        else if (yOverlap == minOverlap) separationNormal.y = std::signbit(boxDelta.y) ? -1.f : 1.f;
-        else if (zOverlap == minOverlap) separationNormal.z = std::signbit(boxDelta.z) ? -1.f : 1.f;
+	return false;
+}
 
-        Response(pAABBObject1, pAABBObject2, -minOverlap, separationNormal);
+void Collision::SetStartHit(glm::vec3 origin, glm::vec3 direction, QueryHit& hit)
+{
+	hit.distance = 0;
+	hit.position = origin;
+	hit.normal = -direction;
+}
 
-        return true;
-    }
 
-	return false;
+// ---- Point Collisions ----
+bool Collision::PointToPlane(glm::vec3 point, const Plane* pPlane)
+{
+	return glm::dot(point, pPlane->GetNormal()) < 0;
 }
@@ -1,40 +1,81 @@
 #pragma once
 
-#include <array>
-#include <glm/fwd.hpp>
+#include "HandleTable.h"
+#include "SceneQuery.h"
+
+#include <cstdint>
+#include <glm/vec3.hpp>
 
 class Plane;
 class PhysicsObject;
+class Shape;
+
+// Where two bodies overlap. Body 2 is pushed along the normal and body 1 the other way.
+struct Contact
+{
+	BodyHandle handle1;
+	BodyHandle handle2;
+	glm::vec3 normal;
+	float overlap;
 
-typedef bool(*CollisionDetectionFunction)(PhysicsObject* pShape1, PhysicsObject* pShape2);
+	// The same for either order of the bodies, the same as the broadphase pair key
+	uint64_t GetPairKey() const {
+		uint32_t slot1 = handle1.index < handle2.index ? handle1.index : handle2.index;
+		uint32_t slot2 = handle1.index < handle2.index ? handle2.index : handle1.index;
+		return (static_cast<uint64_t>(slot1) << 32) | slot2;
+	}
+};
+
+
+// Two bodies for the narrowphase to test
+struct BodyPair
+{
+	BodyHandle handle1;
+	BodyHandle handle2;
+};
 
 
 class Collision
 {
     Collision() = delete;
 public:
+	// Finds the contact and responds to it straight away.
+	// PhysicsScene uses FindContact and resolves all the contacts together, see ContactSolver.
 	static bool Detect(PhysicsObject* pObject1, PhysicsObject* pObject2);
 
+	// Only reads the bodies, so any number of pairs can be tested at once.
+	// When both shapes are known ShapePair<Shape1, Shape2>::FindContact can be used instead,
+	//   see CollisionDispatch.h.
+	static bool FindContact(PhysicsObject* pObject1, PhysicsObject* pObject2, Contact& contact);
 
-private:
-	static const std::array<CollisionDetectionFunction, 9> CollisionDetectionFunctions;
+	// Continuous collision for a sphere that moved from start by displacement over a step, while
+	//   the other body moved by otherDisplacement to where it is now.
+	// Gives the fraction of the step at which they first touch. Returns false if they don't,
+	//   or if they were already touching at the start, which FindContact handles.
+	static bool SweepSphere(glm::vec3 start, glm::vec3 displacement, float radius,
+		PhysicsObject* pOther, glm::vec3 otherDisplacement, float& timeOfImpact);
 
-	// Point Collisions
-	static bool PointToPlane(glm::vec3 point, const Plane* pPlane);
+	// Scene queries against a single body, directions are unit length. Only the hit's
+	//   position, normal and distance are filled in.
+	// A ray starting inside a shape, or a box already overlapping it, hits it at a distance
+	//   of 0 with the normal facing back along the direction.
+	static bool Raycast(const Shape* pShape, glm::vec3 position, glm::vec3 origin, glm::vec3 direction, float maxDistance, QueryHit& hit);
+	static bool OverlapSphere(const Shape* pShape, glm::vec3 position, glm::vec3 center, float radius);
+	static bool SweepBox(const Shape* pShape, glm::vec3 position, glm::vec3 center, glm::vec3 extents, glm::vec3 direction, float maxDistance, QueryHit& hit);
 
-	// Plane Collisions
-	static bool PlaneToSphere(PhysicsObject* pPlaneObject, PhysicsObject* pSphereObject);
-	static bool PlaneToAABB(PhysicsObject* pPlaneObject, PhysicsObject* pAABBObject);
-	static bool PlaneToPlane(PhysicsObject* pPlaneObject1, PhysicsObject* pPlaneObject2);
 
-	// Sphere Collisions
-	static bool SphereToPlane(PhysicsObject* pSphereObject, PhysicsObject* pPlaneObject);
-	static bool SphereToSphere(PhysicsObject* pSphereObject1, PhysicsObject* pSphereObject2);
-	static bool SphereToAABB(PhysicsObject* pSphereObject, PhysicsObject* pAABBObject);
+private:
+	// Swept sphere collisions, the other body's start and the relative displacement
+	static bool SweepSphereToPlane(glm::vec3 start, glm::vec3 displacement, float radius, const Plane* pPlane, float& timeOfImpact);
+	static bool SweepSphereToSphere(glm::vec3 start, glm::vec3 displacement, float radius, glm::vec3 otherStart, float otherRadius, float& timeOfImpact);
+	static bool SweepSphereToAABB(glm::vec3 start, glm::vec3 displacement, float radius, glm::vec3 otherStart, glm::vec3 extents, float& timeOfImpact);
 
-	// AABB Collisions
-	static bool AABBToPlane(PhysicsObject* pAABBObject, PhysicsObject* pPlaneObject);
-	static bool AABBToSphere(PhysicsObject* pAABBObject, PhysicsObject* pSphereObject);
-	static bool AABBToAABB(PhysicsObject* pAABBObject1, PhysicsObject* pAABBObject2);
+	// The distance along the ray to where it enters the box and the axis of the face it
+	//   enters through, or -1 if it starts inside
+	static bool RaycastAABB(glm::vec3 origin, glm::vec3 direction, float maxDistance, glm::vec3 center, glm::vec3 extents, float& distance, int& axis);
+	static bool SweepBoxToSphere(glm::vec3 center, glm::vec3 extents, glm::vec3 direction, float maxDistance, glm::vec3 sphereCenter, float radius, QueryHit& hit);
+	static void SetStartHit(glm::vec3 origin, glm::vec3 direction, QueryHit& hit);
 
+	// Point Collisions
+	static bool PointToPlane(glm::vec3 point, const Plane* pPlane);
 };
@@ -0,0 +1,152 @@
+#include "CollisionBatch.h"
+
+#ifdef PHYSICS_SIMD
+#include <immintrin.h>
+#endif
+
+
+// Appends base + the index of each set bit in the mask
+static void AppendMaskedIndices(int mask, uint32_t base, std::vector<uint32_t>& overlapping)
+{
+	for (uint32_t bit = 0; mask != 0; bit++, mask >>= 1)
+	{
+		if (mask & 1) overlapping.push_back(base + bit);
+	}
+}
+
+
+// ---- Sphere to sphere ----
+void SphereSphereBatch::Clear()
+{
+	m_x1.clear(); m_y1.clear(); m_z1.clear();
+	m_x2.clear(); m_y2.clear(); m_z2.clear();
+	m_radiusSums.clear();
+}
+
+void SphereSphereBatch::Add(glm::vec3 position1, glm::vec3 position2, float radiusSum)
+{
+	m_x1.push_back(position1.x); m_y1.push_back(position1.y); m_z1.push_back(position1.z);
+	m_x2.push_back(position2.x); m_y2.push_back(position2.y); m_z2.push_back(position2.z);
+	m_radiusSums.push_back(radiusSum);
+}
+
+void SphereSphereBatch::FindOverlapsScalar(std::vector<uint32_t>& overlapping) const
+{
+	FindOverlapsScalar(0, overlapping);
+}
+
+void SphereSphereBatch::FindOverlapsScalar(size_t start, std::vector<uint32_t>& overlapping) const
+{
+	for (size_t i = start; i < GetCount(); i++)
+	{
+		float dx = m_x2[i] - m_x1[i];
+		float dy = m_y2[i] - m_y1[i];
+		float dz = m_z2[i] - m_z1[i];
+		float distanceSquared = dx * dx + dy * dy + dz * dz;
+
+		if (distanceSquared < m_radiusSums[i] * m_radiusSums[i]) {
+			overlapping.push_back(static_cast<uint32_t>(i));
+		}
+	}
+}
+
+void SphereSphereBatch::FindOverlaps(std::vector<uint32_t>& overlapping) const
+{
+	size_t i = 0;
+	const size_t count = GetCount();
+
+#if defined(PHYSICS_SIMD) && defined(__AVX__)
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256 dx = _mm256_sub_ps(_mm256_loadu_ps(&m_x2[i]), _mm256_loadu_ps(&m_x1[i]));
+		__m256 dy = _mm256_sub_ps(_mm256_loadu_ps(&m_y2[i]), _mm256_loadu_ps(&m_y1[i]));
+		__m256 dz = _mm256_sub_ps(_mm256_loadu_ps(&m_z2[i]), _mm256_loadu_ps(&m_z1[i]));
+		__m256 distanceSquared = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+
+		__m256 radiusSum = _mm256_loadu_ps(&m_radiusSums[i]);
+		__m256 isOverlapping = _mm256_cmp_ps(distanceSquared, _mm256_mul_ps(radiusSum, radiusSum), _CMP_LT_OQ);
+		AppendMaskedIndices(_mm256_movemask_ps(isOverlapping), static_cast<uint32_t>(i), overlapping);
+	}
+#elif defined(PHYSICS_SIMD)
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 dx = _mm_sub_ps(_mm_loadu_ps(&m_x2[i]), _mm_loadu_ps(&m_x1[i]));
+		__m128 dy = _mm_sub_ps(_mm_loadu_ps(&m_y2[i]), _mm_loadu_ps(&m_y1[i]));
+		__m128 dz = _mm_sub_ps(_mm_loadu_ps(&m_z2[i]), _mm_loadu_ps(&m_z1[i]));
+		__m128 distanceSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+
+		__m128 radiusSum = _mm_loadu_ps(&m_radiusSums[i]);
+		__m128 isOverlapping = _mm_cmplt_ps(distanceSquared, _mm_mul_ps(radiusSum, radiusSum));
+		AppendMaskedIndices(_mm_movemask_ps(isOverlapping), static_cast<uint32_t>(i), overlapping);
+	}
+#endif
+
+	// Whatever didn't fill a whole register
+	FindOverlapsScalar(i, overlapping);
+}
+
+
+// ---- Sphere to plane ----
+void SpherePlaneBatch::Clear()
+{
+	m_x.clear(); m_y.clear(); m_z.clear();
+	m_normalX.clear(); m_normalY.clear(); m_normalZ.clear();
+	m_limits.clear();
+}
+
+void SpherePlaneBatch::Add(glm::vec3 spherePosition, float radius, glm::vec3 planeNormal, float planeDistance)
+{
+	m_x.push_back(spherePosition.x); m_y.push_back(spherePosition.y); m_z.push_back(spherePosition.z);
+	m_normalX.push_back(planeNormal.x); m_normalY.push_back(planeNormal.y); m_normalZ.push_back(planeNormal.z);
+	m_limits.push_back(planeDistance + radius);
+}
+
+void SpherePlaneBatch::FindOverlapsScalar(std::vector<uint32_t>& overlapping) const
+{
+	FindOverlapsScalar(0, overlapping);
+}
+
+void SpherePlaneBatch::FindOverlapsScalar(size_t start, std::vector<uint32_t>& overlapping) const
+{
+	for (size_t i = start; i < GetCount(); i++)
+	{
+		// Where the sphere center is along the plane normal
+		float distance = m_x[i] * m_normalX[i] + m_y[i] * m_normalY[i] + m_z[i] * m_normalZ[i];
+
+		if (distance < m_limits[i]) {
+			overlapping.push_back(static_cast<uint32_t>(i));
+		}
+	}
+}
+
+void SpherePlaneBatch::FindOverlaps(std::vector<uint32_t>& overlapping) const
+{
+	size_t i = 0;
+	const size_t count = GetCount();
+
+#if defined(PHYSICS_SIMD) && defined(__AVX__)
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256 distance = _mm256_add_ps(_mm256_add_ps(
+			_mm256_mul_ps(_mm256_loadu_ps(&m_x[i]), _mm256_loadu_ps(&m_normalX[i])),
+			_mm256_mul_ps(_mm256_loadu_ps(&m_y[i]), _mm256_loadu_ps(&m_normalY[i]))),
+			_mm256_mul_ps(_mm256_loadu_ps(&m_z[i]), _mm256_loadu_ps(&m_normalZ[i])));
+
+		__m256 isOverlapping = _mm256_cmp_ps(distance, _mm256_loadu_ps(&m_limits[i]), _CMP_LT_OQ);
+		AppendMaskedIndices(_mm256_movemask_ps(isOverlapping), static_cast<uint32_t>(i), overlapping);
+	}
+#elif defined(PHYSICS_SIMD)
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 distance = _mm_add_ps(_mm_add_ps(
+			_mm_mul_ps(_mm_loadu_ps(&m_x[i]), _mm_loadu_ps(&m_normalX[i])),
+			_mm_mul_ps(_mm_loadu_ps(&m_y[i]), _mm_loadu_ps(&m_normalY[i]))),
+			_mm_mul_ps(_mm_loadu_ps(&m_z[i]), _mm_loadu_ps(&m_normalZ[i])));
+
+		__m128 isOverlapping = _mm_cmplt_ps(distance, _mm_loadu_ps(&m_limits[i]));
+		AppendMaskedIndices(_mm_movemask_ps(isOverlapping), static_cast<uint32_t>(i), overlapping);
+	}
+#endif
+
+	FindOverlapsScalar(i, overlapping);
+}
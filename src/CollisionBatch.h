@@ -0,0 +1,51 @@
+#pragma once
+
+#include "Simd.h"
+
+#include <glm/vec3.hpp>
+
+#include <cstdint>
+#include <vector>
+
+
+// Sphere pairs gathered in structure of arrays form, so the overlap test can be run on
+//   several pairs per instruction. Compares squared distances, there's no sqrt.
+class SphereSphereBatch
+{
+public:
+	void Clear();
+	void Add(glm::vec3 position1, glm::vec3 position2, float radiusSum);
+	size_t GetCount() const { return m_radiusSums.size(); }
+
+	// Appends the index of each overlapping pair, in order.
+	// Uses SSE or AVX when built with them, otherwise the same as FindOverlapsScalar.
+	void FindOverlaps(std::vector<uint32_t>& overlapping) const;
+	void FindOverlapsScalar(std::vector<uint32_t>& overlapping) const;
+
+private:
+	void FindOverlapsScalar(size_t start, std::vector<uint32_t>& overlapping) const;
+
+	std::vector<float> m_x1, m_y1, m_z1;
+	std::vector<float> m_x2, m_y2, m_z2;
+	std::vector<float> m_radiusSums;
+};
+
+
+// Sphere and plane pairs in structure of arrays form, see SphereSphereBatch.
+class SpherePlaneBatch
+{
+public:
+	void Clear();
+	void Add(glm::vec3 spherePosition, float radius, glm::vec3 planeNormal, float planeDistance);
+	size_t GetCount() const { return m_limits.size(); }
+
+	void FindOverlaps(std::vector<uint32_t>& overlapping) const;
+	void FindOverlapsScalar(std::vector<uint32_t>& overlapping) const;
+
+private:
+	void FindOverlapsScalar(size_t start, std::vector<uint32_t>& overlapping) const;
+
+	std::vector<float> m_x, m_y, m_z;
+	std::vector<float> m_normalX, m_normalY, m_normalZ;
+	std::vector<float> m_limits; // Plane distance plus sphere radius
+};
@@ -0,0 +1,292 @@
+#pragma once
+
+#include "Collision.h"
+#include "PhysicsObject.h"
+#include "Shapes.h"
+
+#include <algorithm>
+#include <cmath>
+#include <glm/glm.hpp>
+
+// Collision tests between shapes known at compile time, so they can be inlined into loops over
+//   pairs of the same shapes.
+// ShapePair is specialised for pairs in shape ID order. The reverse order forwards to it with
+//   the bodies swapped, and pairs in order without a specialisation never collide.
+// Adding a shape means adding it to CollisionShapes and specialising its pairs, Collision::FindContact
+//   is generated from them.
+
+
+// Every shape that can collide, in shape ID order
+template<typename... Shapes>
+struct ShapeList
+{
+	static constexpr int Count = sizeof...(Shapes);
+};
+
+typedef ShapeList<Plane, Sphere, AABB> CollisionShapes;
+static_assert(CollisionShapes::Count == Shape::GetShapeCount(), "Every shape needs to be in CollisionShapes");
+
+
+inline Contact MakeContact(PhysicsObject* pObject1, PhysicsObject* pObject2, float overlap, glm::vec3 normal)
+{
+	return Contact{ pObject1->GetHandle(), pObject2->GetHandle(), normal, overlap };
+}
+
+
+template<typename Shape1, typename Shape2, bool IsInOrder = (Shape1::TypeID <= Shape2::TypeID)>
+struct ShapePair
+{
+	static bool FindContact(PhysicsObject* pObject1, PhysicsObject* pObject2, Contact& contact)
+	{
+		return ShapePair<Shape2, Shape1>::FindContact(pObject2, pObject1, contact);
+	}
+};
+
+template<typename Shape1, typename Shape2>
+struct ShapePair<Shape1, Shape2, true>
+{
+	static bool FindContact(PhysicsObject*, PhysicsObject*, Contact&)
+	{
+		return false;
+	}
+};
+
+
+// ---- Plane collisions ----
+template<>
+struct ShapePair<Plane, Sphere>
+{
+	static bool FindContact(PhysicsObject* pPlaneObject, PhysicsObject* pSphereObject, Contact& contact)
+	{
+		const auto pSphere = pSphereObject->GetShape<Sphere>();
+		const auto pPlane = pPlaneObject->GetShape<Plane>();
+
+		const glm::vec3 sphereVector = pSphereObject->GetPosition();
+		const glm::vec3 planeNormal = pPlane->GetNormal();
+
+		// Where does the sphere center point overlap the plane normal
+		float sphereDistanceAlongPlaneNormal = glm::dot(sphereVector, planeNormal);
+
+		// If the plane distane and sphere radius are bigger then the distance along the normal
+		//   then we overlap.
+		float overlap = sphereDistanceAlongPlaneNormal - (pPlane->GetDistance() + pSphere->GetRadius());
+		if (overlap < 0)
+		{
+			contact = MakeContact(pPlaneObject, pSphereObject, -overlap, planeNormal);
+			return true;
+		}
+
+		return false;
+	}
+};
+
+template<>
+struct ShapePair<Plane, AABB>
+{
+	static bool FindContact(PhysicsObject* pPlaneObject, PhysicsObject* pAABBObject, Contact& contact)
+	{
+		const auto pPlane = pPlaneObject->GetShape<Plane>();
+		const auto pAABB = pAABBObject->GetShape<AABB>();
+
+		glm::vec3 AABBPos = pAABBObject->GetPosition();
+		glm::vec3 minPos = AABBPos - pAABB->GetExtents();
+		glm::vec3 maxPos = AABBPos + pAABB->GetExtents();
+
+		float minPointDistanceAlongPlaneNormal = glm::dot(minPos, pPlane->GetNormal());
+		float maxPointDistanceAlongPlaneNormal = glm::dot(maxPos, pPlane->GetNormal());
+
+		float overlap = std::min(minPointDistanceAlongPlaneNormal, maxPointDistanceAlongPlaneNormal);
+
+		if(overlap < 0 ) {
+			contact = MakeContact(pPlaneObject, pAABBObject, -overlap, pPlane->GetNormal());
+			return true;
+		}
+
+		return false;
+	}
+};
+
+// Plane to plane isn't implemented, planes are only ever static.
+
+
+// ---- Sphere collisions ----
+template<>
+struct ShapePair<Sphere, Sphere>
+{
+	static bool FindContact(PhysicsObject* pSphereObject1, PhysicsObject* pSphereObject2, Contact& contact)
+	{
+		const auto pSphere1 = pSphereObject1->GetShape<Sphere>();
+		const auto pSphere2 = pSphereObject2->GetShape<Sphere>();
+
+		glm::vec3 directionVector = pSphereObject2->GetPosition() - pSphereObject1->GetPosition();
+		float centerDistance = glm::length(directionVector);
+		float radiusDistance = pSphere1->GetRadius() + pSphere2->GetRadius();
+
+		float overlap = centerDistance - radiusDistance;
+		if (overlap < 0) {
+			contact = MakeContact(pSphereObject1, pSphereObject2, -overlap, glm::normalize(directionVector));
+			return true;
+		}
+
+		return false;
+	}
+};
+
+template<>
+struct ShapePair<Sphere, AABB>
+{
+	static bool FindContact(PhysicsObject* pSphereObject, PhysicsObject* pAABBObject, Contact& contact)
+	{
+	    const auto pSphere = pSphereObject->GetShape<Sphere>();
+	    const auto pAABB = pAABBObject->GetShape<AABB>();
+
+	    glm::vec3 minPos = -pAABB->GetExtents();
+	    glm::vec3 maxPos = pAABB->GetExtents();
+
+	    glm::vec3 distance = pSphereObject->GetPosition() - pAABBObject->GetPosition();
+		glm::vec3 clampedPoint = distance;
+
+	    if (distance.x < minPos.x)
+	        clampedPoint.x = minPos.x;
+	    else if (distance.x > maxPos.x)
+	        clampedPoint.x = maxPos.x;
+
+	    if (distance.y < minPos.y)
+	        clampedPoint.y = minPos.y;
+	    else if (distance.y > maxPos.y)
+	        clampedPoint.y = maxPos.y;
+
+	    if (distance.z < minPos.z)
+	        clampedPoint.z = minPos.z;
+	    else if (distance.z > maxPos.z)
+	        clampedPoint.z = maxPos.z;
+
+	    glm::vec3 clampedDistance = distance - clampedPoint;
+
+	    float overlap = glm::length(clampedDistance) - pSphere->GetRadius();
+	    if (overlap < 0)
+	    {
+	        contact = MakeContact(pAABBObject, pSphereObject, -overlap, glm::normalize(clampedDistance));
+	        return true;
+	    }
+
+		return false;
+	}
+};
+
+
+// ---- AABB collisions ----
+template<>
+struct ShapePair<AABB, AABB>
+{
+	static bool FindContact(PhysicsObject* pAABBObject1, PhysicsObject* pAABBObject2, Contact& contact)
+	{
+	    const auto pAABB1 = pAABBObject1->GetShape<AABB>();
+	    const auto pAABB2 = pAABBObject2->GetShape<AABB>();
+
+	    glm::vec3 box1Pos = pAABBObject1->GetPosition();
+	    glm::vec3 box1Extents = pAABB1->GetExtents();
+
+	    glm::vec3 box2Pos = pAABBObject2->GetPosition();
+	    glm::vec3 box2Extents = pAABB2->GetExtents();
+
+		glm::vec3 boxDelta = box2Pos - box1Pos;
+		glm::vec3 boxExtentsCombined = box1Extents + box2Extents;
+
+	    float xOverlap = std::abs(boxDelta.x) - boxExtentsCombined.x;
+	    float yOverlap = std::abs(boxDelta.y) - boxExtentsCombined.y;
+	    float zOverlap = std::abs(boxDelta.z) - boxExtentsCombined.z;
+
+
+	    if (xOverlap <= 0 && yOverlap <= 0 && zOverlap <= 0)
+	    {
+	        // Separate along the axis with the least overlap
+	        float minOverlap = std::max(xOverlap, std::max(yOverlap, zOverlap));
+        
+	        glm::vec3 separationNormal(0);
+
+	        if (xOverlap == minOverlap) separationNormal.x = std::signbit(boxDelta.x) ? -1.f : 1.f;
+	        else if (yOverlap == minOverlap) separationNormal.y = std::signbit(boxDelta.y) ? -1.f : 1.f;
+	        else if (zOverlap == minOverlap) separationNormal.z = std::signbit(boxDelta.z) ? -1.f : 1.f;
+
+	        contact = MakeContact(pAABBObject1, pAABBObject2, -minOverlap, separationNormal);
+
+	        return true;
+	    }
+
+		return false;
+	}
+};
+
+
+// Finds the types of both shapes, then calls their ShapePair
+template<typename Shape1, typename List>
+struct ShapePairDispatch2;
+
+template<typename Shape1>
+struct ShapePairDispatch2<Shape1, ShapeList<>>
+{
+	static bool FindContact(int, PhysicsObject*, PhysicsObject*, Contact&) { return false; }
+};
+
+template<typename Shape1, typename Shape2, typename... Shapes>
+struct ShapePairDispatch2<Shape1, ShapeList<Shape2, Shapes...>>
+{
+	static bool FindContact(int shapeID2, PhysicsObject* pObject1, PhysicsObject* pObject2, Contact& contact)
+	{
+		if (shapeID2 == static_cast<int>(Shape2::TypeID)) {
+			return ShapePair<Shape1, Shape2>::FindContact(pObject1, pObject2, contact);
+		}
+		return ShapePairDispatch2<Shape1, ShapeList<Shapes...>>::FindContact(shapeID2, pObject1, pObject2, contact);
+	}
+};
+
+template<typename List>
+struct ShapePairDispatch;
+
+template<>
+struct ShapePairDispatch<ShapeList<>>
+{
+	static bool FindContact(int, int, PhysicsObject*, PhysicsObject*, Contact&) { return false; }
+};
+
+template<typename Shape1, typename... Shapes>
+struct ShapePairDispatch<ShapeList<Shape1, Shapes...>>
+{
+	static bool FindContact(int shapeID1, int shapeID2, PhysicsObject* pObject1, PhysicsObject* pObject2, Contact& contact)
+	{
+		if (shapeID1 == static_cast<int>(Shape1::TypeID)) {
+			return ShapePairDispatch2<Shape1, CollisionShapes>::FindContact(shapeID2, pObject1, pObject2, contact);
+		}
+		return ShapePairDispatch<ShapeList<Shapes...>>::FindContact(shapeID1, shapeID2, pObject1, pObject2, contact);
+	}
+};
+
+
+// Calls function with a ShapePairType for each pair of shapes in the list, in shape ID order
+template<typename Shape1, typename Shape2>
+struct ShapePairType
+{
+	typedef Shape1 First;
+	typedef Shape2 Second;
+};
+
+template<typename Shape1, typename Function>
+void ForEachShapePairWith(ShapeList<>, Function&) {}
+
+template<typename Shape1, typename Shape2, typename... Shapes, typename Function>
+void ForEachShapePairWith(ShapeList<Shape2, Shapes...>, Function& function)
+{
+	function(ShapePairType<Shape1, Shape2>());
+	ForEachShapePairWith<Shape1>(ShapeList<Shapes...>(), function);
+}
+
+template<typename Function>
+void ForEachShapePair(ShapeList<>, Function&) {}
+
+template<typename Shape1, typename... Shapes, typename Function>
+void ForEachShapePair(ShapeList<Shape1, Shapes...>, Function& function)
+{
+	ForEachShapePairWith<Shape1>(ShapeList<Shape1, Shapes...>(), function);
+	ForEachShapePair(ShapeList<Shapes...>(), function);
+}
@@ -0,0 +1,372 @@
+#include "ContactSolver.h"
+
+#include "BodyStore.h"
+#include "Islands.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <glm/glm.hpp>
+
+constexpr float ContactSolver::DefaultTolerance;
+constexpr float ContactSolver::Restitution;
+constexpr float ContactSolver::RestitutionVelocity;
+const uint32_t ContactSolver::LargeIslandContacts;
+
+// A cached impulse is only reused if the normal hasn't turned much
+static const float MinWarmStartNormalDot = 0.95f;
+// Bodies are left overlapping by this much, so a resting contact is still found next step
+static const float AllowedOverlap = 0.005f;
+// Overlap left that's small enough to stop separating
+static const float SeparationTolerance = 0.0001f;
+
+// A bit per color in a body's mask. Contacts that don't fit are solved on one thread.
+static const int MaxColors = 64;
+static const uint32_t NoIsland = UINT32_MAX;
+
+// Enough work per job to be worth handing to another thread
+static const size_t IslandsPerJob = 16;
+static const size_t ConstraintsPerJob = 256;
+
+
+void ContactSolver::Solve(BodyStore& bodies, const std::vector<Contact>& contacts, JobSystem* pJobSystem)
+{
+	m_stats.contactCount = static_cast<uint32_t>(contacts.size());
+	m_stats.warmStartedCount = 0;
+	m_stats.iterationCount = 0;
+	m_stats.residuals.clear();
+
+	glm::vec3* velocities = bodies.GetVelocities();
+	glm::vec3* positions = bodies.GetPositions();
+
+	BuildConstraints(bodies, contacts);
+	if (m_isWarmStarting) {
+		WarmStart(velocities, contacts);
+	}
+	Schedule(bodies.GetCount());
+
+	for (int i = 0; i < m_iterationCount && !m_constraints.empty(); i++)
+	{
+		float residual = RunScheduled(pJobSystem, [this, velocities](uint32_t begin, uint32_t end) {
+			return SolveIteration(velocities, begin, end);
+		});
+		m_stats.residuals.push_back(residual);
+		m_stats.iterationCount++;
+
+		if (residual <= m_tolerance) break;
+	}
+
+	for (int i = 0; i < m_iterationCount; i++)
+	{
+		float largestOverlap = RunScheduled(pJobSystem, [this, positions](uint32_t begin, uint32_t end) {
+			return Separate(positions, begin, end);
+		});
+		if (largestOverlap <= SeparationTolerance) break;
+	}
+
+	CacheImpulses(contacts);
+}
+
+void ContactSolver::BuildConstraints(BodyStore& bodies, const std::vector<Contact>& contacts)
+{
+	const glm::vec3* positions = bodies.GetPositions();
+	const glm::vec3* velocities = bodies.GetVelocities();
+	const float* inverseMasses = bodies.GetInverseMasses();
+
+	m_constraints.clear();
+	for (const Contact& contact : contacts)
+	{
+		Constraint constraint;
+		constraint.index1 = static_cast<uint32_t>(bodies.GetIndex(contact.handle1));
+		constraint.index2 = static_cast<uint32_t>(bodies.GetIndex(contact.handle2));
+		constraint.normal = contact.normal;
+		constraint.inverseMass1 = inverseMasses[constraint.index1];
+		constraint.inverseMass2 = inverseMasses[constraint.index2];
+
+		float inverseMassSum = constraint.inverseMass1 + constraint.inverseMass2;
+		constraint.effectiveMass = inverseMassSum > 0 ? 1 / inverseMassSum : 0;
+
+		// Bounce back at a fraction of the closing speed, from before any impulse this step
+		float velocityAlongNormal = glm::dot(velocities[constraint.index2] - velocities[constraint.index1], contact.normal);
+		constraint.targetVelocity = velocityAlongNormal < -RestitutionVelocity ? -Restitution * velocityAlongNormal : 0;
+
+		constraint.impulse = 0;
+		constraint.overlap = contact.overlap;
+		constraint.startPosition1 = positions[constraint.index1];
+		constraint.startPosition2 = positions[constraint.index2];
+		constraint.contactIndex = static_cast<uint32_t>(m_constraints.size());
+		m_constraints.push_back(constraint);
+	}
+}
+
+void ContactSolver::WarmStart(glm::vec3* velocities, const std::vector<Contact>& contacts)
+{
+	// Both are sorted by key, so they're matched in one pass
+	auto cached = std::begin(m_cachedImpulses);
+	for (size_t i = 0; i < contacts.size(); i++)
+	{
+		const Contact& contact = contacts[i];
+		uint64_t key = contact.GetPairKey();
+		while (cached != std::end(m_cachedImpulses) && cached->key < key) ++cached;
+		if (cached == std::end(m_cachedImpulses)) break;
+
+		// The slot could have been reused by another body since
+		if (cached->key != key || cached->handle1 != contact.handle1 || cached->handle2 != contact.handle2) continue;
+		if (glm::dot(cached->normal, contact.normal) < MinWarmStartNormalDot) continue;
+
+		Constraint& constraint = m_constraints[i];
+		constraint.impulse = cached->impulse;
+		velocities[constraint.index1] -= constraint.normal * (constraint.impulse * constraint.inverseMass1);
+		velocities[constraint.index2] += constraint.normal * (constraint.impulse * constraint.inverseMass2);
+		m_stats.warmStartedCount++;
+	}
+}
+
+void ContactSolver::Schedule(size_t bodyCount)
+{
+	m_islandParents.resize(bodyCount);
+	m_islandIndexes.resize(bodyCount);
+	m_bodyColors.resize(bodyCount);
+	for (const Constraint& constraint : m_constraints)
+	{
+		m_islandParents[constraint.index1] = constraint.index1;
+		m_islandParents[constraint.index2] = constraint.index2;
+		m_islandIndexes[constraint.index1] = NoIsland;
+		m_islandIndexes[constraint.index2] = NoIsland;
+	}
+
+	// Static and kinematic bodies don't join islands together
+	for (const Constraint& constraint : m_constraints)
+	{
+		if (constraint.inverseMass1 == 0 || constraint.inverseMass2 == 0) continue;
+
+		uint32_t island1 = FindIsland(m_islandParents, constraint.index1);
+		uint32_t island2 = FindIsland(m_islandParents, constraint.index2);
+		m_islandParents[island2] = island1;
+	}
+
+	// Islands are numbered in the order of their first constraint. Constraints without a
+	//   dynamic body don't change anything, so they're left out.
+	auto getIsland = [this](const Constraint& constraint) {
+		if (constraint.inverseMass1 == 0 && constraint.inverseMass2 == 0) return NoIsland;
+		return m_islandIndexes[FindIsland(m_islandParents, constraint.inverseMass1 > 0 ? constraint.index1 : constraint.index2)];
+	};
+
+	m_islandSizes.clear();
+	for (const Constraint& constraint : m_constraints)
+	{
+		if (constraint.inverseMass1 == 0 && constraint.inverseMass2 == 0) continue;
+
+		uint32_t root = FindIsland(m_islandParents, constraint.inverseMass1 > 0 ? constraint.index1 : constraint.index2);
+		if (m_islandIndexes[root] == NoIsland) {
+			m_islandIndexes[root] = static_cast<uint32_t>(m_islandSizes.size());
+			m_islandSizes.push_back(0);
+		}
+		m_islandSizes[m_islandIndexes[root]]++;
+	}
+
+	// Small islands go first so they can be handed out together, then the large islands
+	m_islandRanges.clear();
+	m_islandOffsets.resize(m_islandSizes.size());
+	uint32_t offset = 0;
+	for (int isLarge = 0; isLarge < 2; isLarge++)
+	{
+		for (size_t island = 0; island < m_islandSizes.size(); island++)
+		{
+			if ((m_islandSizes[island] > LargeIslandContacts) != (isLarge != 0)) continue;
+
+			// Large islands get their ranges once they're colored
+			m_islandOffsets[island] = offset;
+			if (!isLarge) m_islandRanges.push_back(ConstraintRange{ offset, offset + m_islandSizes[island], false });
+			offset += m_islandSizes[island];
+		}
+	}
+	m_activeCount = offset;
+
+	// Each island keeps its constraints in the contacts' order
+	m_scheduledConstraints.resize(m_constraints.size());
+	uint32_t inactiveOffset = m_activeCount;
+	for (const Constraint& constraint : m_constraints)
+	{
+		uint32_t island = getIsland(constraint);
+		uint32_t& index = island == NoIsland ? inactiveOffset : m_islandOffsets[island];
+		m_scheduledConstraints[index++] = constraint;
+	}
+	std::swap(m_constraints, m_scheduledConstraints);
+
+	m_colorRanges.clear();
+	for (size_t island = 0; island < m_islandSizes.size(); island++)
+	{
+		if (m_islandSizes[island] <= LargeIslandContacts) continue;
+
+		// The offset is now the island's end
+		ColorIsland(m_islandOffsets[island] - m_islandSizes[island], m_islandOffsets[island]);
+	}
+
+	m_stats.islandCount = static_cast<uint32_t>(m_islandSizes.size());
+	m_stats.largeIslandCount = static_cast<uint32_t>(m_islandSizes.size() - m_islandRanges.size());
+	m_stats.colorCount = static_cast<uint32_t>(m_colorRanges.size());
+}
+
+void ContactSolver::ColorIsland(uint32_t begin, uint32_t end)
+{
+	for (uint32_t i = begin; i < end; i++)
+	{
+		m_bodyColors[m_constraints[i].index1] = 0;
+		m_bodyColors[m_constraints[i].index2] = 0;
+	}
+
+	// Greedy, each constraint takes the first color neither of its dynamic bodies has yet
+	uint32_t colorSizes[MaxColors + 1] = {};
+	m_constraintColors.resize(end - begin);
+	for (uint32_t i = begin; i < end; i++)
+	{
+		const Constraint& constraint = m_constraints[i];
+		uint64_t usedColors = (constraint.inverseMass1 > 0 ? m_bodyColors[constraint.index1] : 0) |
+			(constraint.inverseMass2 > 0 ? m_bodyColors[constraint.index2] : 0);
+
+		int color = 0;
+		while (color < MaxColors && (usedColors & (uint64_t(1) << color)) != 0) color++;
+		if (color < MaxColors) {
+			if (constraint.inverseMass1 > 0) m_bodyColors[constraint.index1] |= uint64_t(1) << color;
+			if (constraint.inverseMass2 > 0) m_bodyColors[constraint.index2] |= uint64_t(1) << color;
+		}
+
+		m_constraintColors[i - begin] = color;
+		colorSizes[color]++;
+	}
+
+	// Sorted by color, keeping the contacts' order within each
+	uint32_t colorOffsets[MaxColors + 1];
+	uint32_t offset = begin;
+	for (int color = 0; color <= MaxColors; color++)
+	{
+		colorOffsets[color] = offset;
+		if (colorSizes[color] == 0) continue;
+
+		m_colorRanges.push_back(ConstraintRange{ offset, offset + colorSizes[color], color < MaxColors });
+		offset += colorSizes[color];
+	}
+
+	for (uint32_t i = begin; i < end; i++)
+	{
+		m_scheduledConstraints[colorOffsets[m_constraintColors[i - begin]]++] = m_constraints[i];
+	}
+	std::copy(m_scheduledConstraints.begin() + begin, m_scheduledConstraints.begin() + end, m_constraints.begin() + begin);
+}
+
+template<typename SolveRange>
+float ContactSolver::RunScheduled(JobSystem* pJobSystem, const SolveRange& solveRange)
+{
+	float result = 0;
+	if (pJobSystem == nullptr) {
+		for (const ConstraintRange& range : m_islandRanges)
+		{
+			result = std::max(result, solveRange(range.begin, range.end));
+		}
+		for (const ConstraintRange& range : m_colorRanges)
+		{
+			result = std::max(result, solveRange(range.begin, range.end));
+		}
+		return result;
+	}
+
+	// Each thread keeps its own largest result, they're combined at the end
+	m_threadResults.assign(pJobSystem->GetThreadCount(), 0.0f);
+
+	pJobSystem->ParallelFor(m_islandRanges.size(), IslandsPerJob, [&](size_t begin, size_t end, unsigned int threadIndex) {
+		for (size_t i = begin; i < end; i++)
+		{
+			m_threadResults[threadIndex] = std::max(m_threadResults[threadIndex], solveRange(m_islandRanges[i].begin, m_islandRanges[i].end));
+		}
+	});
+
+	// Each color finishes before the next starts, as they share bodies
+	for (const ConstraintRange& range : m_colorRanges)
+	{
+		if (!range.isParallel) {
+			m_threadResults[0] = std::max(m_threadResults[0], solveRange(range.begin, range.end));
+			continue;
+		}
+
+		pJobSystem->ParallelFor(range.end - range.begin, ConstraintsPerJob, [&](size_t begin, size_t end, unsigned int threadIndex) {
+			uint32_t rangeBegin = range.begin + static_cast<uint32_t>(begin);
+			uint32_t rangeEnd = range.begin + static_cast<uint32_t>(end);
+			m_threadResults[threadIndex] = std::max(m_threadResults[threadIndex], solveRange(rangeBegin, rangeEnd));
+		});
+	}
+
+	for (float threadResult : m_threadResults)
+	{
+		result = std::max(result, threadResult);
+	}
+	return result;
+}
+
+// Static and kinematic bodies are shared between islands and colors, so they're never
+//   written, an impulse wouldn't change them anyway
+float ContactSolver::SolveIteration(glm::vec3* velocities, uint32_t begin, uint32_t end)
+{
+	float residual = 0;
+
+	for (uint32_t i = begin; i < end; i++)
+	{
+		Constraint& constraint = m_constraints[i];
+		glm::vec3& velocity1 = velocities[constraint.index1];
+		glm::vec3& velocity2 = velocities[constraint.index2];
+
+		float velocityAlongNormal = glm::dot(velocity2 - velocity1, constraint.normal);
+		float impulseDelta = (constraint.targetVelocity - velocityAlongNormal) * constraint.effectiveMass;
+
+		// The total impulse can push the bodies apart but never pull them together
+		float impulse = std::max(constraint.impulse + impulseDelta, 0.0f);
+		impulseDelta = impulse - constraint.impulse;
+		constraint.impulse = impulse;
+
+		if (constraint.inverseMass1 > 0) velocity1 -= constraint.normal * (impulseDelta * constraint.inverseMass1);
+		if (constraint.inverseMass2 > 0) velocity2 += constraint.normal * (impulseDelta * constraint.inverseMass2);
+
+		residual = std::max(residual, std::abs(impulseDelta));
+	}
+
+	return residual;
+}
+
+float ContactSolver::Separate(glm::vec3* positions, uint32_t begin, uint32_t end)
+{
+	float largestOverlap = 0;
+
+	for (uint32_t i = begin; i < end; i++)
+	{
+		const Constraint& constraint = m_constraints[i];
+		float inverseMassSum = constraint.inverseMass1 + constraint.inverseMass2;
+		if (inverseMassSum == 0) continue;
+
+		// What's left of the overlap once the bodies have been moved by other contacts
+		glm::vec3 relativeMovement = (positions[constraint.index2] - constraint.startPosition2) - (positions[constraint.index1] - constraint.startPosition1);
+		float overlap = constraint.overlap - AllowedOverlap - glm::dot(relativeMovement, constraint.normal);
+		if (overlap <= 0) continue;
+
+		// Split by mass, the lighter body moves further
+		glm::vec3 separation = constraint.normal * (overlap / inverseMassSum);
+		if (constraint.inverseMass1 > 0) positions[constraint.index1] -= separation * constraint.inverseMass1;
+		if (constraint.inverseMass2 > 0) positions[constraint.index2] += separation * constraint.inverseMass2;
+
+		largestOverlap = std::max(largestOverlap, overlap);
+	}
+
+	return largestOverlap;
+}
+
+void ContactSolver::CacheImpulses(const std::vector<Contact>& contacts)
+{
+	// Back in the contacts' order, so the cache stays sorted by key
+	m_nextCachedImpulses.resize(contacts.size());
+	for (const Constraint& constraint : m_constraints)
+	{
+		const Contact& contact = contacts[constraint.contactIndex];
+		m_nextCachedImpulses[constraint.contactIndex] = CachedImpulse{ contact.GetPairKey(), contact.handle1, contact.handle2, contact.normal, constraint.impulse };
+	}
+
+	// Contacts not found this step are dropped
+	std::swap(m_cachedImpulses, m_nextCachedImpulses);
+}
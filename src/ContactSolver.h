@@ -0,0 +1,132 @@
+#pragma once
+
+#include "Collision.h"
+#include "Snapshot.h"
+
+#include <cstdint>
+#include <vector>
+
+class BodyStore;
+class JobSystem;
+
+// Resolves contacts with sequential impulses. Each iteration goes through every contact,
+//   pushing the bodies apart along the contact normal by however much is still needed.
+//   Later contacts see the velocities left by earlier ones, so stacks settle together.
+// Impulses are kept for the next step, keyed by body pair. A contact that persists starts
+//   from last step's impulse, which is usually close, so fewer iterations are needed.
+// Contacts are split into islands of dynamic bodies touching each other, which can be solved
+//   at the same time. Large islands are split further by coloring their contacts, so no two
+//   contacts of a color share a dynamic body. Static and kinematic bodies are never changed,
+//   so they can be shared. The order contacts are solved in doesn't depend on the threads.
+class ContactSolver
+{
+public:
+	static const int DefaultIterations = 10;
+	// Stops early once no impulse changes by more than this in an iteration
+	static constexpr float DefaultTolerance = 0.0001f;
+	static constexpr float Restitution = 0.5f;
+	// Slower collisions don't bounce, so resting contacts come to rest
+	static constexpr float RestitutionVelocity = 1.0f;
+	// Islands with more contacts than this are colored, smaller ones are solved whole in their
+	//   contacts' order
+	static const uint32_t LargeIslandContacts = 256;
+
+	struct Stats
+	{
+		uint32_t contactCount;
+		uint32_t warmStartedCount;
+		uint32_t islandCount;
+		uint32_t largeIslandCount;
+		uint32_t colorCount; // Summed over the large islands
+		int iterationCount;
+		// The largest change in a contact's impulse in each iteration
+		std::vector<float> residuals;
+	};
+
+	void SetIterations(int iterationCount) { m_iterationCount = iterationCount; }
+	void SetTolerance(float tolerance) { m_tolerance = tolerance; }
+	void SetWarmStarting(bool isWarmStarting) { m_isWarmStarting = isWarmStarting; }
+
+	// The contacts must be sorted by pair key. Changes the velocities, then moves the bodies
+	//   apart, also over a number of iterations.
+	// Islands and colors are split across the job system's threads, when there is one.
+	void Solve(BodyStore& bodies, const std::vector<Contact>& contacts, JobSystem* pJobSystem = nullptr);
+
+	// Stats from the last call to Solve
+	const Stats& GetStats() const { return m_stats; }
+
+	// The impulses kept for warm starting the next step.
+	// Restore leaves the cache unchanged and returns false if the snapshot is broken.
+	void SaveCache(SnapshotWriter& writer) const { writer.WriteArray(m_cachedImpulses); }
+	bool RestoreCache(SnapshotReader& reader) { return reader.ReadArray(m_cachedImpulses); }
+
+private:
+	struct Constraint
+	{
+		uint32_t index1;
+		uint32_t index2;
+		glm::vec3 normal;
+		float inverseMass1;
+		float inverseMass2;
+		float effectiveMass;
+		float targetVelocity; // Along the normal, from the restitution
+		float impulse; // Accumulated over the iterations, never pulls the bodies together
+		float overlap;
+		glm::vec3 startPosition1; // Where the bodies were when the overlap was found
+		glm::vec3 startPosition2;
+		uint32_t contactIndex;
+	};
+
+	// Constraints [begin, end) in m_constraints once scheduled
+	struct ConstraintRange
+	{
+		uint32_t begin;
+		uint32_t end;
+		bool isParallel; // No two constraints share a dynamic body
+	};
+
+	struct CachedImpulse
+	{
+		uint64_t key;
+		BodyHandle handle1;
+		BodyHandle handle2;
+		glm::vec3 normal;
+		float impulse;
+	};
+
+	void BuildConstraints(BodyStore& bodies, const std::vector<Contact>& contacts);
+	void WarmStart(glm::vec3* velocities, const std::vector<Contact>& contacts);
+	void Schedule(size_t bodyCount);
+	void ColorIsland(uint32_t begin, uint32_t end);
+
+	// Runs solveRange(begin, end) over every island and color, returns the largest result
+	template<typename SolveRange>
+	float RunScheduled(JobSystem* pJobSystem, const SolveRange& solveRange);
+	float SolveIteration(glm::vec3* velocities, uint32_t begin, uint32_t end);
+	float Separate(glm::vec3* positions, uint32_t begin, uint32_t end);
+	void CacheImpulses(const std::vector<Contact>& contacts);
+
+	int m_iterationCount = DefaultIterations;
+	float m_tolerance = DefaultTolerance;
+	bool m_isWarmStarting = true;
+
+	std::vector<Constraint> m_constraints; // In the contacts' order until scheduled
+	std::vector<Constraint> m_scheduledConstraints;
+
+	// Small islands, then a range per color of each large island in order
+	std::vector<ConstraintRange> m_islandRanges;
+	std::vector<ConstraintRange> m_colorRanges;
+	uint32_t m_activeCount = 0; // Constraints between two dynamic bodies or one, the rest are left out
+
+	// Indexed by body, only set for bodies in a constraint
+	std::vector<uint32_t> m_islandParents;
+	std::vector<uint32_t> m_islandIndexes;
+	std::vector<uint64_t> m_bodyColors; // A bit per color a body's constraints have
+	std::vector<uint32_t> m_islandSizes;
+	std::vector<uint32_t> m_islandOffsets;
+	std::vector<uint32_t> m_constraintColors;
+	std::vector<float> m_threadResults;
+	std::vector<CachedImpulse> m_cachedImpulses; // Sorted by key
+	std::vector<CachedImpulse> m_nextCachedImpulses;
+	Stats m_stats = Stats();
+};
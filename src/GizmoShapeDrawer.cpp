@@ -0,0 +1,22 @@
+#include "GizmoShapeDrawer.h"
+
+#include "Gizmos.h"
+
+#include <glm/vec4.hpp>
+
+
+void GizmoShapeDrawer::DrawSphere(glm::vec3 position, float radius)
+{
+	Gizmos::addSphereFilled(position, radius, 10, 10, glm::vec4(0.5f, 0, 0, 1));
+}
+
+void GizmoShapeDrawer::DrawAABB(glm::vec3 position, glm::vec3 extents)
+{
+	Gizmos::addAABBFilled(position, extents, glm::vec4(0, 0.5f, 0, 1));
+}
+
+void GizmoShapeDrawer::DrawPlane(glm::vec3 position, glm::vec3 normal, float distance)
+{
+	// Only ever used for the ground, so it's drawn as a flat square
+	Gizmos::addAABBFilled(position, glm::vec3(100.f, 0.f, 100.f), glm::vec4(0.25f, 0.25f, 0.25f, 1));
+}
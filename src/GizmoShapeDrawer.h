@@ -0,0 +1,12 @@
+#pragma once
+
+#include "ShapeDrawer.h"
+
+// Draws shapes with Gizmos, in the colours the testbed has always used
+class GizmoShapeDrawer : public ShapeDrawer
+{
+public:
+	void DrawSphere(glm::vec3 position, float radius) override;
+	void DrawAABB(glm::vec3 position, glm::vec3 extents) override;
+	void DrawPlane(glm::vec3 position, glm::vec3 normal, float distance) override;
+};
@@ -0,0 +1,167 @@
+#pragma once
+
+#include "Snapshot.h"
+
+#include <assert.h>
+#include <cstdint>
+#include <vector>
+
+// Identifies a body in a scene.
+// The generation changes each time a slot is reused, so a handle to a removed body
+//   never refers to a body added later.
+struct BodyHandle
+{
+	uint32_t index; // The slot in the handle table
+	uint32_t generation;
+
+	bool operator==(const BodyHandle& other) const { return index == other.index && generation == other.generation; }
+	bool operator!=(const BodyHandle& other) const { return !(*this == other); }
+
+	static BodyHandle Invalid() { return BodyHandle{ UINT32_MAX, 0 }; }
+};
+
+
+// Maps handles to the index of their body in densely packed arrays.
+// When a body is removed the last body is moved into its place, Move updates its handle.
+class HandleTable
+{
+public:
+	HandleTable() : m_freeList(NullSlot) {}
+
+	BodyHandle Create(uint32_t denseIndex)
+	{
+		uint32_t slot;
+		if (m_freeList != NullSlot) {
+			slot = m_freeList;
+			m_freeList = m_slots[slot].denseIndex;
+		}
+		else {
+			slot = static_cast<uint32_t>(m_slots.size());
+			m_slots.push_back(Slot{ 0, 0, false });
+		}
+
+		m_slots[slot].denseIndex = denseIndex;
+		m_slots[slot].isAlive = true;
+		return BodyHandle{ slot, m_slots[slot].generation };
+	}
+
+	void Destroy(BodyHandle handle)
+	{
+		assert(IsValid(handle));
+
+		Slot& slot = m_slots[handle.index];
+		slot.generation++;
+		slot.isAlive = false;
+		slot.denseIndex = m_freeList;
+		m_freeList = handle.index;
+	}
+
+	void Move(BodyHandle handle, uint32_t denseIndex)
+	{
+		assert(IsValid(handle));
+		m_slots[handle.index].denseIndex = denseIndex;
+	}
+
+	bool IsValid(BodyHandle handle) const
+	{
+		return handle.index < m_slots.size() &&
+			m_slots[handle.index].isAlive &&
+			m_slots[handle.index].generation == handle.generation;
+	}
+
+	uint32_t GetDenseIndex(BodyHandle handle) const
+	{
+		assert(IsValid(handle));
+		return m_slots[handle.index].denseIndex;
+	}
+
+	// The live handle using a slot
+	BodyHandle GetHandle(uint32_t slot) const { return BodyHandle{ slot, m_slots[slot].generation }; }
+
+	// Slots are reused, so this only grows to the most bodies alive at once
+	uint32_t GetSlotCount() const { return static_cast<uint32_t>(m_slots.size()); }
+
+	// Counts the live slots, so it takes as long as there are slots
+	uint32_t GetLiveCount() const
+	{
+		uint32_t liveCount = 0;
+		for (const Slot& slot : m_slots)
+		{
+			if (slot.isAlive) liveCount++;
+		}
+		return liveCount;
+	}
+
+	// Slots are written as separate arrays, so no padding ends up in the snapshot
+	void Save(SnapshotWriter& writer) const
+	{
+		std::vector<uint32_t> denseIndexes(m_slots.size());
+		std::vector<uint32_t> generations(m_slots.size());
+		std::vector<uint8_t> isAlive(m_slots.size());
+		for (size_t i = 0; i < m_slots.size(); i++)
+		{
+			denseIndexes[i] = m_slots[i].denseIndex;
+			generations[i] = m_slots[i].generation;
+			isAlive[i] = m_slots[i].isAlive ? 1 : 0;
+		}
+
+		writer.Write(m_freeList);
+		writer.WriteArray(denseIndexes);
+		writer.WriteArray(generations);
+		writer.WriteArray(isAlive);
+	}
+
+	// Leaves the table unchanged if the snapshot is broken.
+	// Dense indexes of live slots aren't checked, the caller knows how many bodies there are
+	//   and has to check there's a live slot for each, see GetLiveCount.
+	bool Restore(SnapshotReader& reader)
+	{
+		uint32_t freeList;
+		size_t slotCount;
+		if (!reader.Read(freeList)) return false;
+		const uint32_t* denseIndexes = reader.ReadArray<uint32_t>(slotCount);
+		if (denseIndexes == nullptr) return false;
+		const uint32_t* generations = reader.ReadArray<uint32_t>(slotCount, slotCount);
+		const uint8_t* isAlive = reader.ReadArray<uint8_t>(slotCount, slotCount);
+		if (generations == nullptr || isAlive == nullptr) return false;
+
+		// Every dead slot has to be on the free list once, and no live slot can be, otherwise
+		//   Create would hand out a slot that's in use. Visiting a slot twice means a cycle.
+		std::vector<uint8_t> isFree(slotCount, 0);
+		size_t freeCount = 0;
+		for (uint32_t slot = freeList; slot != NullSlot; slot = denseIndexes[slot])
+		{
+			if (slot >= slotCount || isAlive[slot] || isFree[slot]) return false;
+			isFree[slot] = 1;
+			freeCount++;
+		}
+
+		size_t liveCount = 0;
+		for (size_t i = 0; i < slotCount; i++)
+		{
+			if (isAlive[i]) liveCount++;
+		}
+		if (freeCount + liveCount != slotCount) return false;
+
+		m_slots.resize(slotCount);
+		for (size_t i = 0; i < slotCount; i++)
+		{
+			m_slots[i] = Slot{ denseIndexes[i], generations[i], isAlive[i] != 0 };
+		}
+		m_freeList = freeList;
+		return true;
+	}
+
+private:
+	static const uint32_t NullSlot = UINT32_MAX;
+
+	struct Slot
+	{
+		uint32_t denseIndex; // The next free slot when not alive
+		uint32_t generation;
+		bool isAlive;
+	};
+
+	std::vector<Slot> m_slots;
+	uint32_t m_freeList;
+};
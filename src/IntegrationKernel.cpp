@@ -0,0 +1,111 @@
+#include "IntegrationKernel.h"
+
+#include "RigidBody.h"
+
+#include <glm/glm.hpp>
+
+#ifdef PHYSICS_SIMD
+#include <immintrin.h>
+#endif
+
+
+size_t IntegrateBodiesScalar(const IntegrationBatch& batch, size_t begin, size_t end)
+{
+	size_t awakeCount = 0;
+	for (size_t i = begin; i < end; i++)
+	{
+		batch.forces[i] += batch.dampingCoefficient * -batch.velocities[i] * batch.deltaTime;
+
+		// Sleeping bodies don't move
+		if (!batch.isAwake[i]) {
+			if (batch.displacements != nullptr) batch.displacements[i] = glm::vec3(0);
+			continue;
+		}
+
+		awakeCount++;
+		glm::vec3 displacement = RigidBody::Integrate(batch.velocities[i], batch.forces[i], batch.inverseMasses[i], batch.deltaTime, batch.gravity);
+		batch.positions[i] += displacement;
+		batch.forces[i] = glm::vec3(0);
+		if (batch.displacements != nullptr) batch.displacements[i] = displacement;
+	}
+	return awakeCount;
+}
+
+#ifdef PHYSICS_SIMD
+// Four packed vec3s fill three registers, x0 y0 z0 x1 | y1 z1 x2 y2 | z2 x3 y3 z3.
+// Spreads one value per body to line up with its components.
+static void SpreadPerBody(__m128 values, __m128 spread[3])
+{
+	spread[0] = _mm_shuffle_ps(values, values, _MM_SHUFFLE(1, 0, 0, 0));
+	spread[1] = _mm_shuffle_ps(values, values, _MM_SHUFFLE(2, 2, 1, 1));
+	spread[2] = _mm_shuffle_ps(values, values, _MM_SHUFFLE(3, 3, 3, 2));
+}
+
+// a where the mask is set, otherwise b
+static __m128 Select(__m128 mask, __m128 a, __m128 b)
+{
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+#endif
+
+size_t IntegrateBodies(const IntegrationBatch& batch, size_t begin, size_t end)
+{
+	size_t i = begin;
+	size_t awakeCount = 0;
+
+#ifdef PHYSICS_SIMD
+	const __m128 signMask = _mm_set1_ps(-0.0f);
+	const __m128 damping = _mm_set1_ps(batch.dampingCoefficient);
+	const __m128 deltaTime = _mm_set1_ps(batch.deltaTime);
+	const __m128 half = _mm_set1_ps(0.5f);
+
+	// Gravity's change to the velocity, repeated to line up with the packed vec3s
+	const glm::vec3 gravity = batch.gravity * batch.deltaTime;
+	const __m128 gravityStep[3] = {
+		_mm_setr_ps(gravity.x, gravity.y, gravity.z, gravity.x),
+		_mm_setr_ps(gravity.y, gravity.z, gravity.x, gravity.y),
+		_mm_setr_ps(gravity.z, gravity.x, gravity.y, gravity.z),
+	};
+
+	for (; i + 4 <= end; i += 4)
+	{
+		float* pPositions = &batch.positions[i].x;
+		float* pVelocities = &batch.velocities[i].x;
+		float* pForces = &batch.forces[i].x;
+
+		__m128 inverseMasses[3];
+		SpreadPerBody(_mm_loadu_ps(&batch.inverseMasses[i]), inverseMasses);
+
+		__m128i awakeFlags = _mm_setr_epi32(batch.isAwake[i], batch.isAwake[i + 1], batch.isAwake[i + 2], batch.isAwake[i + 3]);
+		__m128 awakeMask = _mm_castsi128_ps(_mm_cmpgt_epi32(awakeFlags, _mm_setzero_si128()));
+		int awakeBits = _mm_movemask_ps(awakeMask);
+		awakeCount += (awakeBits & 1) + ((awakeBits >> 1) & 1) + ((awakeBits >> 2) & 1) + ((awakeBits >> 3) & 1);
+		__m128 isAwake[3];
+		SpreadPerBody(awakeMask, isAwake);
+
+		for (int k = 0; k < 3; k++)
+		{
+			__m128 position = _mm_loadu_ps(pPositions + 4 * k);
+			__m128 velocity = _mm_loadu_ps(pVelocities + 4 * k);
+			__m128 force = _mm_loadu_ps(pForces + 4 * k);
+
+			force = _mm_add_ps(force, _mm_mul_ps(_mm_mul_ps(damping, _mm_xor_ps(velocity, signMask)), deltaTime));
+
+			// RigidBody::Integrate
+			__m128 newVelocity = _mm_add_ps(velocity, _mm_mul_ps(_mm_mul_ps(force, inverseMasses[k]), deltaTime));
+			newVelocity = _mm_add_ps(newVelocity, gravityStep[k]);
+			__m128 displacement = _mm_mul_ps(_mm_mul_ps(_mm_add_ps(velocity, newVelocity), half), deltaTime);
+
+			// Selected rather than masked, adding a zero displacement would turn -0 into 0
+			_mm_storeu_ps(pPositions + 4 * k, Select(isAwake[k], _mm_add_ps(position, displacement), position));
+			_mm_storeu_ps(pVelocities + 4 * k, Select(isAwake[k], newVelocity, velocity));
+			_mm_storeu_ps(pForces + 4 * k, _mm_andnot_ps(isAwake[k], force));
+			if (batch.displacements != nullptr) {
+				_mm_storeu_ps(&batch.displacements[i].x + 4 * k, _mm_and_ps(isAwake[k], displacement));
+			}
+		}
+	}
+#endif
+
+	return awakeCount + IntegrateBodiesScalar(batch, i, end);
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "Simd.h"
+
+#include <glm/vec3.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+// The dynamic bodies' arrays from a BodyStore, and what to step them by
+struct IntegrationBatch
+{
+	glm::vec3* positions;
+	glm::vec3* velocities;
+	glm::vec3* forces;
+	const float* inverseMasses;
+	const uint8_t* isAwake;
+	// How far each body moved, zero for sleeping bodies. Not written when null.
+	glm::vec3* displacements;
+
+	float deltaTime;
+	float dampingCoefficient;
+	glm::vec3 gravity;
+};
+
+// Damps every body in [begin, end), then moves the awake ones with the midpoint method of
+//   RigidBody::Integrate and clears their forces. Sleeping bodies keep their damped force.
+// Returns how many bodies were awake.
+// Uses SSE when built with it. Every lane does the same operations in the same order as
+//   IntegrateBodiesScalar, so the results are identical as long as the compiler doesn't fuse
+//   the scalar ones into FMAs. PhysicsCore is built with contraction off for that reason.
+size_t IntegrateBodies(const IntegrationBatch& batch, size_t begin, size_t end);
+size_t IntegrateBodiesScalar(const IntegrationBatch& batch, size_t begin, size_t end);
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Union find over body indexes, used to gather bodies in contact into islands.
+// Halves the path on the way up.
+inline uint32_t FindIsland(std::vector<uint32_t>& parents, uint32_t index)
+{
+	while (parents[index] != index)
+	{
+		parents[index] = parents[parents[index]];
+		index = parents[index];
+	}
+	return index;
+}
@@ -0,0 +1,126 @@
+#include "JobSystem.h"
+
+
+// Which pool, if any, the current thread is a worker of
+static thread_local const JobSystem* t_pJobSystem = nullptr;
+static thread_local unsigned int t_threadIndex = 0;
+
+
+JobSystem::JobSystem(unsigned int threadCount) :
+	m_queuedJobCount(0)
+{
+	if (threadCount == 0) {
+		threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+	}
+
+	for (unsigned int i = 0; i < threadCount; i++)
+	{
+		m_queues.push_back(std::make_unique<Queue>());
+	}
+
+	// Thread 0 is the calling thread
+	for (unsigned int i = 1; i < threadCount; i++)
+	{
+		m_threads.emplace_back(&JobSystem::WorkerLoop, this, i);
+	}
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_wakeMutex);
+		m_isStopping = true;
+	}
+	m_wakeCondition.notify_all();
+
+	for (auto& thread : m_threads)
+	{
+		thread.join();
+	}
+}
+
+unsigned int JobSystem::GetThreadIndex() const
+{
+	return t_pJobSystem == this ? t_threadIndex : 0;
+}
+
+void JobSystem::Run(Job job, JobCounter& counter)
+{
+	counter++;
+
+	Queue& queue = *m_queues[GetThreadIndex()];
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.jobs.push_back(QueuedJob{ std::move(job), &counter });
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_wakeMutex);
+		m_queuedJobCount++;
+	}
+	m_wakeCondition.notify_one();
+}
+
+void JobSystem::Wait(const JobCounter& counter)
+{
+	const unsigned int threadIndex = GetThreadIndex();
+	while (counter > 0)
+	{
+		if (!TryRunJob(threadIndex)) {
+			std::this_thread::yield();
+		}
+	}
+}
+
+void JobSystem::WorkerLoop(unsigned int threadIndex)
+{
+	t_pJobSystem = this;
+	t_threadIndex = threadIndex;
+
+	while (true)
+	{
+		if (TryRunJob(threadIndex)) continue;
+
+		std::unique_lock<std::mutex> lock(m_wakeMutex);
+		m_wakeCondition.wait(lock, [this]() { return m_queuedJobCount > 0 || m_isStopping; });
+		if (m_isStopping) return;
+	}
+}
+
+bool JobSystem::TryRunJob(unsigned int threadIndex)
+{
+	QueuedJob queuedJob;
+	if (!TryPop(threadIndex, queuedJob)) return false;
+
+	queuedJob.job();
+	(*queuedJob.pCounter)--;
+	return true;
+}
+
+bool JobSystem::TryPop(unsigned int threadIndex, QueuedJob& queuedJob)
+{
+	const unsigned int threadCount = GetThreadCount();
+
+	// Newest job from our own queue first, then steal the oldest from the others
+	for (unsigned int i = 0; i < threadCount; i++)
+	{
+		unsigned int queueIndex = (threadIndex + i) % threadCount;
+		Queue& queue = *m_queues[queueIndex];
+
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.jobs.empty()) continue;
+
+		if (queueIndex == threadIndex) {
+			queuedJob = std::move(queue.jobs.back());
+			queue.jobs.pop_back();
+		}
+		else {
+			queuedJob = std::move(queue.jobs.front());
+			queue.jobs.pop_front();
+		}
+		m_queuedJobCount--;
+		return true;
+	}
+
+	return false;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A pool of threads that share jobs by work stealing.
+// Each thread has its own queue. Jobs are pushed and popped at the back of it, and a thread
+//   that runs out of work steals from the front of the others.
+// The thread that made the pool, usually the main thread, is thread 0. It runs jobs while it
+//   waits, so a pool with a thread count of 1 runs everything on that thread.
+class JobSystem
+{
+public:
+	typedef std::function<void()> Job;
+	// The number of jobs started with the counter that haven't finished
+	typedef std::atomic<int> JobCounter;
+
+	// Zero makes one thread per hardware thread, including the calling thread
+	explicit JobSystem(unsigned int threadCount = 0);
+	~JobSystem();
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	unsigned int GetThreadCount() const { return static_cast<unsigned int>(m_queues.size()); }
+	// Index of the calling thread, 0 for any thread that isn't a worker of this pool.
+	// Useful for picking a per thread buffer, which then doesn't need a lock.
+	unsigned int GetThreadIndex() const;
+
+	void Run(Job job, JobCounter& counter);
+	// Runs queued jobs until the counter reaches zero
+	void Wait(const JobCounter& counter);
+
+	// Calls function(begin, end, threadIndex) over [0, count) in ranges of up to grainSize items.
+	// Returns once every range is done.
+	template<typename Function>
+	void ParallelFor(size_t count, size_t grainSize, const Function& function);
+
+private:
+	struct QueuedJob
+	{
+		Job job;
+		JobCounter* pCounter;
+	};
+
+	struct Queue
+	{
+		std::mutex mutex;
+		std::deque<QueuedJob> jobs;
+	};
+
+	void WorkerLoop(unsigned int threadIndex);
+	bool TryRunJob(unsigned int threadIndex);
+	bool TryPop(unsigned int threadIndex, QueuedJob& queuedJob);
+
+	std::vector<std::unique_ptr<Queue>> m_queues;
+	std::vector<std::thread> m_threads;
+
+	// Sleeping workers are woken when a job is queued
+	std::mutex m_wakeMutex;
+	std::condition_variable m_wakeCondition;
+	std::atomic<int> m_queuedJobCount;
+	bool m_isStopping = false;
+};
+
+
+template<typename Function>
+void JobSystem::ParallelFor(size_t count, size_t grainSize, const Function& function)
+{
+	grainSize = std::max<size_t>(grainSize, 1);
+	if (count <= grainSize || GetThreadCount() == 1) {
+		if (count > 0) function(size_t(0), count, GetThreadIndex());
+		return;
+	}
+
+	JobCounter counter(0);
+	for (size_t begin = 0; begin < count; begin += grainSize)
+	{
+		size_t end = std::min(begin + grainSize, count);
+		Run([this, &function, begin, end]() { function(begin, end, GetThreadIndex()); }, counter);
+	}
+	Wait(counter);
+}
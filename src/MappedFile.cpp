@@ -0,0 +1,102 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const char* pPath)
+{
+	Close();
+
+	m_fileHandle = CreateFileA(pPath, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (m_fileHandle == INVALID_HANDLE_VALUE) {
+		m_fileHandle = nullptr;
+		return false;
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(m_fileHandle, &size) || size.QuadPart == 0) {
+		Close();
+		return false;
+	}
+
+	m_mappingHandle = CreateFileMappingA(m_fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (m_mappingHandle == nullptr) {
+		Close();
+		return false;
+	}
+
+	m_pData = MapViewOfFile(m_mappingHandle, FILE_MAP_READ, 0, 0, 0);
+	if (m_pData == nullptr) {
+		Close();
+		return false;
+	}
+
+	m_size = static_cast<size_t>(size.QuadPart);
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (m_pData != nullptr) {
+		UnmapViewOfFile(m_pData);
+	}
+	if (m_mappingHandle != nullptr) {
+		CloseHandle(m_mappingHandle);
+	}
+	if (m_fileHandle != nullptr) {
+		CloseHandle(m_fileHandle);
+	}
+
+	m_pData = nullptr;
+	m_size = 0;
+	m_mappingHandle = nullptr;
+	m_fileHandle = nullptr;
+}
+
+#else
+
+bool MappedFile::Open(const char* pPath)
+{
+	Close();
+
+	int file = open(pPath, O_RDONLY);
+	if (file < 0) return false;
+
+	struct stat status;
+	if (fstat(file, &status) != 0 || status.st_size == 0) {
+		close(file);
+		return false;
+	}
+
+	// The mapping keeps the file open
+	void* pData = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+	close(file);
+	if (pData == MAP_FAILED) return false;
+
+	m_pData = pData;
+	m_size = static_cast<size_t>(status.st_size);
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (m_pData != nullptr) {
+		munmap(const_cast<void*>(m_pData), m_size);
+	}
+
+	m_pData = nullptr;
+	m_size = 0;
+}
+
+#endif
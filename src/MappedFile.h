@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+
+// A file mapped read only into memory. Pages are read from disk as they're first touched,
+//   so opening even a large file is quick.
+class MappedFile
+{
+public:
+	MappedFile() {}
+	~MappedFile() { Close(); }
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// Returns false if the file couldn't be opened or is empty
+	bool Open(const char* pPath);
+	void Close();
+
+	const void* GetData() const { return m_pData; }
+	size_t GetSize() const { return m_size; }
+
+private:
+	const void* m_pData = nullptr;
+	size_t m_size = 0;
+#ifdef _WIN32
+	void* m_fileHandle = nullptr;
+	void* m_mappingHandle = nullptr;
+#endif
+};
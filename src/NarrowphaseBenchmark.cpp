@@ -0,0 +1,64 @@
+#include "NarrowphaseBenchmark.h"
+
+#include "CollisionBatch.h"
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+
+template<typename Kernel>
+static double TimeKernel(Kernel kernel, int iterations, std::vector<uint32_t>& overlapping)
+{
+	auto startTime = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < iterations; i++)
+	{
+		overlapping.clear();
+		kernel(overlapping);
+	}
+	auto endTime = std::chrono::high_resolution_clock::now();
+	return std::chrono::duration<double, std::milli>(endTime - startTime).count() / iterations;
+}
+
+static void PrintResult(const char* pName, int pairCount, double scalarTime, double simdTime, bool isMatching)
+{
+	printf("%-14s %9d pairs  scalar %8.3f ms  simd %8.3f ms  speedup %5.2fx  %s\n",
+		pName, pairCount, scalarTime, simdTime, scalarTime / simdTime, isMatching ? "results match" : "RESULTS DIFFER");
+}
+
+void RunNarrowphaseBenchmark(int pairCount, int iterations)
+{
+#ifdef PHYSICS_SIMD
+	printf("Narrowphase benchmark, SIMD enabled\n");
+#else
+	printf("Narrowphase benchmark, SIMD disabled, both kernels are scalar\n");
+#endif
+
+	std::default_random_engine generator;
+	std::uniform_real_distribution<float> positionDistribution(-2, 2);
+	std::uniform_real_distribution<float> radiusDistribution(0.5f, 1.5f);
+	auto randomPosition = [&]() {
+		return glm::vec3(positionDistribution(generator), positionDistribution(generator), positionDistribution(generator));
+	};
+
+	SphereSphereBatch sphereBatch;
+	SpherePlaneBatch planeBatch;
+	for (int i = 0; i < pairCount; i++)
+	{
+		sphereBatch.Add(randomPosition(), randomPosition(), radiusDistribution(generator) + radiusDistribution(generator));
+		planeBatch.Add(randomPosition(), radiusDistribution(generator), glm::vec3(0, 1, 0), 0);
+	}
+
+	std::vector<uint32_t> scalarOverlaps;
+	std::vector<uint32_t> simdOverlaps;
+	scalarOverlaps.reserve(pairCount);
+	simdOverlaps.reserve(pairCount);
+
+	double scalarTime = TimeKernel([&](std::vector<uint32_t>& overlaps) { sphereBatch.FindOverlapsScalar(overlaps); }, iterations, scalarOverlaps);
+	double simdTime = TimeKernel([&](std::vector<uint32_t>& overlaps) { sphereBatch.FindOverlaps(overlaps); }, iterations, simdOverlaps);
+	PrintResult("sphere-sphere", pairCount, scalarTime, simdTime, scalarOverlaps == simdOverlaps);
+
+	scalarTime = TimeKernel([&](std::vector<uint32_t>& overlaps) { planeBatch.FindOverlapsScalar(overlaps); }, iterations, scalarOverlaps);
+	simdTime = TimeKernel([&](std::vector<uint32_t>& overlaps) { planeBatch.FindOverlaps(overlaps); }, iterations, simdOverlaps);
+	PrintResult("sphere-plane", pairCount, scalarTime, simdTime, scalarOverlaps == simdOverlaps);
+}
@@ -0,0 +1,5 @@
+#pragma once
+
+// Times the scalar and SIMD sphere overlap kernels on random pairs and prints the results.
+// Run with PhysicsBenchmark --narrowphase
+void RunNarrowphaseBenchmark(int pairCount = 1000000, int iterations = 20);
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <assert.h>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// What a pool has taken from the heap
+struct PoolStats
+{
+	size_t liveCount;		// Objects created and not yet destroyed
+	size_t capacity;		// Objects the slabs allocated so far have room for
+	size_t slabAllocations;	// Only ever grows, so it's unchanged across anything that didn't allocate
+};
+
+
+// Makes objects in slabs of SlabSize at a time, so objects made one after another sit next
+//   to each other in memory and only one in SlabSize creations touches the heap.
+// A destroyed object's slot is reused by the next object made.
+// Slabs are only freed along with the pool, without destroying the objects still in them,
+//   so only types with trivial destructors can be pooled.
+template<typename T, size_t SlabSize = 1024>
+class ObjectPool
+{
+	static_assert(std::is_trivially_destructible<T>::value, "Objects left in a pool are never destroyed");
+
+public:
+	ObjectPool() : m_pFreeList(nullptr), m_stats{ 0, 0, 0 } {}
+
+	ObjectPool(ObjectPool&& other) : ObjectPool() { *this = std::move(other); }
+	ObjectPool& operator=(ObjectPool&& other)
+	{
+		std::swap(m_slabs, other.m_slabs);
+		std::swap(m_pFreeList, other.m_pFreeList);
+		std::swap(m_stats, other.m_stats);
+		return *this;
+	}
+
+	template<typename... Args>
+	T* Create(Args&&... args)
+	{
+		if (m_pFreeList == nullptr) AllocateSlab();
+
+		Slot* pSlot = m_pFreeList;
+		m_pFreeList = pSlot->pNext;
+		m_stats.liveCount++;
+		return new (&pSlot->storage) T(std::forward<Args>(args)...);
+	}
+
+	// Must have come from this pool
+	void Destroy(T* pObject)
+	{
+		assert(m_stats.liveCount > 0);
+
+		// The object is the only member of its slot, so they share an address
+		Slot* pSlot = reinterpret_cast<Slot*>(pObject);
+		pSlot->pNext = m_pFreeList;
+		m_pFreeList = pSlot;
+		m_stats.liveCount--;
+	}
+
+	const PoolStats& GetStats() const { return m_stats; }
+
+private:
+	union Slot
+	{
+		Slot* pNext; // While on the free list
+		typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+	};
+
+	void AllocateSlab()
+	{
+		m_slabs.emplace_back(new Slot[SlabSize]);
+		Slot* pSlab = m_slabs.back().get();
+
+		// Linked backwards, so the slots are handed out in the order they sit in memory
+		for (size_t i = SlabSize; i-- > 0; )
+		{
+			pSlab[i].pNext = m_pFreeList;
+			m_pFreeList = &pSlab[i];
+		}
+
+		m_stats.capacity += SlabSize;
+		m_stats.slabAllocations++;
+	}
+
+	std::vector< std::unique_ptr<Slot[]> > m_slabs;
+	Slot* m_pFreeList;
+	PoolStats m_stats;
+};
@@ -54,66 +54,258 @@ PhysXScene::~PhysXScene()
 }
 
 
-void PhysXScene::AddPlaneStatic(glm::vec3 normal, float distance) 
+BodyHandle PhysXScene::AddPlaneStatic(glm::vec3 normal, float distance) 
 {
 	PxTransform transform = PxTransformFromPlaneEquation(PxPlane(normal.x, normal.y, normal.z, distance));
 	PxRigidStatic* pPlane = PxCreateStatic(*m_pPhysics, transform, PxPlaneGeometry(), *m_pDefaultMaterial);
-	m_pScene->addActor(*pPlane);
+	return AddActor(pPlane);
 }
 
 
-void PhysXScene::AddSphereStatic(glm::vec3 position, float radius) 
+BodyHandle PhysXScene::AddSphereStatic(glm::vec3 position, float radius) 
 {
 	PxTransform transform(position.x, position.y, position.z);
 	PxSphereGeometry sphereGeo(radius);
 	PxRigidStatic* pSphere = PxCreateStatic(*m_pPhysics, transform, sphereGeo, *m_pDefaultMaterial);
-	m_pScene->addActor(*pSphere);
+	return AddActor(pSphere);
 }
 
-void PhysXScene::AddAABBStatic(glm::vec3 position, glm::vec3 extents) 
+BodyHandle PhysXScene::AddAABBStatic(glm::vec3 position, glm::vec3 extents) 
 {
 	PxTransform transform(position.x, position.y, position.z);
 	PxBoxGeometry boxGeo(extents.x, extents.y, extents.z);
 	PxRigidStatic* pBox = PxCreateStatic(*m_pPhysics, transform, boxGeo, *m_pDefaultMaterial);
-	m_pScene->addActor(*pBox);
+	return AddActor(pBox);
 }
 
 
-void PhysXScene::AddPlaneDynamic(glm::vec3 normal, float distance, float mass, glm::vec3 velocity) 
+BodyHandle PhysXScene::AddPlaneDynamic(glm::vec3 normal, float distance, float mass, glm::vec3 velocity) 
 {
 	PxTransform transform = PxTransformFromPlaneEquation(PxPlane(normal.x, normal.y, normal.z, distance));
 	PxRigidDynamic* pPlane = PxCreateDynamic(*m_pPhysics, transform, PxPlaneGeometry(), *m_pDefaultMaterial, DefaultDensity);
 	pPlane->setLinearVelocity(PxVec3(velocity.x, velocity.y, velocity.z));
-	m_pScene->addActor(*pPlane);
+	return AddActor(pPlane);
 }
 
 
-void PhysXScene::AddSphereDynamic(glm::vec3 position, float radius, float mass, glm::vec3 velocity) 
+BodyHandle PhysXScene::AddSphereDynamic(glm::vec3 position, float radius, float mass, glm::vec3 velocity) 
 {
 	PxTransform transform(position.x, position.y, position.z);
 	PxSphereGeometry sphereGeo(radius);
 	PxRigidDynamic* pSphere = PxCreateDynamic(*m_pPhysics, transform, sphereGeo, *m_pDefaultMaterial, DefaultDensity);
 	pSphere->setLinearVelocity(PxVec3(velocity.x, velocity.y, velocity.z));
-	m_pScene->addActor(*pSphere);
+	return AddActor(pSphere);
 }
 
-void PhysXScene::AddAABBDynamic(glm::vec3 position, glm::vec3 extents, float mass, glm::vec3 velocity) 
+BodyHandle PhysXScene::AddAABBDynamic(glm::vec3 position, glm::vec3 extents, float mass, glm::vec3 velocity) 
 {
 	PxTransform transform(position.x, position.y, position.z);
 	PxBoxGeometry boxGeo(extents.x, extents.y, extents.z);
 	PxRigidDynamic* pBox = PxCreateDynamic(*m_pPhysics, transform, boxGeo, *m_pDefaultMaterial, DefaultDensity);
 	pBox->setLinearVelocity(PxVec3(velocity.x, velocity.y, velocity.z));
-	m_pScene->addActor(*pBox);
+	return AddActor(pBox);
 }
 
 
 
+void PhysXScene::AddSpheresDynamic(size_t count, const glm::vec3* pPositions, const float* pRadii, const float* pMasses, const glm::vec3* pVelocities, BodyHandle* pHandles)
+{
+	std::vector<PxActor*> pActors(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		PxTransform transform(pPositions[i].x, pPositions[i].y, pPositions[i].z);
+		PxRigidDynamic* pSphere = PxCreateDynamic(*m_pPhysics, transform, PxSphereGeometry(pRadii[i]), *m_pDefaultMaterial, DefaultDensity);
+		pSphere->setLinearVelocity(PxVec3(pVelocities[i].x, pVelocities[i].y, pVelocities[i].z));
+		pActors[i] = pSphere;
+	}
+	AddActors(count, pActors.data(), pHandles);
+}
+
+void PhysXScene::AddAABBsDynamic(size_t count, const glm::vec3* pPositions, const glm::vec3* pExtents, const float* pMasses, const glm::vec3* pVelocities, BodyHandle* pHandles)
+{
+	std::vector<PxActor*> pActors(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		PxTransform transform(pPositions[i].x, pPositions[i].y, pPositions[i].z);
+		PxBoxGeometry boxGeo(pExtents[i].x, pExtents[i].y, pExtents[i].z);
+		PxRigidDynamic* pBox = PxCreateDynamic(*m_pPhysics, transform, boxGeo, *m_pDefaultMaterial, DefaultDensity);
+		pBox->setLinearVelocity(PxVec3(pVelocities[i].x, pVelocities[i].y, pVelocities[i].z));
+		pActors[i] = pBox;
+	}
+	AddActors(count, pActors.data(), pHandles);
+}
+
+
+BodyHandle PhysXScene::AddActor(PxRigidActor* pActor)
+{
+	BodyHandle handle = TrackActor(pActor);
+	m_pScene->addActor(*pActor);
+	return handle;
+}
+
+void PhysXScene::AddActors(size_t count, PxActor* const* ppActors, BodyHandle* pHandles)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		BodyHandle handle = TrackActor(static_cast<PxRigidActor*>(ppActors[i]));
+		if (pHandles != nullptr) pHandles[i] = handle;
+	}
+
+	// One call inserts them all, rather than taking the scene's lock and growing its arrays once per actor
+	m_pScene->addActors(ppActors, static_cast<PxU32>(count));
+}
+
+BodyHandle PhysXScene::TrackActor(PxRigidActor* pActor)
+{
+	BodyHandle handle = m_handleTable.Create(static_cast<uint32_t>(m_pActors.size()));
+	m_actorHandles.push_back(handle);
+	m_pActors.push_back(pActor);
+	m_actorAges.push_back(0);
+
+	// The slot stays the same while the actor lives, so scene query hits can find its handle
+	pActor->userData = reinterpret_cast<void*>(static_cast<uintptr_t>(handle.index));
+	return handle;
+}
+
+void PhysXScene::Remove(BodyHandle handle)
+{
+	if (!m_handleTable.IsValid(handle)) return;
+
+	// Releasing the actor also removes it from the scene
+	uint32_t index = m_handleTable.GetDenseIndex(handle);
+	m_pActors[index]->release();
+
+	// The last actor takes the removed actor's place
+	m_handleTable.Move(m_actorHandles.back(), index);
+	m_handleTable.Destroy(handle);
+
+	m_actorHandles[index] = m_actorHandles.back();
+	m_pActors[index] = m_pActors.back();
+	m_actorAges[index] = m_actorAges.back();
+	m_actorHandles.pop_back();
+	m_pActors.pop_back();
+	m_actorAges.pop_back();
+}
+
+size_t PhysXScene::GetBodyCount() const
+{
+	return m_pActors.size();
+}
+
+BodyHandle PhysXScene::GetActorHandle(const PxRigidActor* pActor) const
+{
+	return m_handleTable.GetHandle(static_cast<uint32_t>(reinterpret_cast<uintptr_t>(pActor->userData)));
+}
+
+bool PhysXScene::Raycast(glm::vec3 origin, glm::vec3 direction, float maxDistance, QueryHit& hit, uint32_t layerMask)
+{
+	hit.handle = BodyHandle::Invalid();
+
+	float length = glm::length(direction);
+	if (length == 0) return false;
+	direction /= length;
+
+	PxRaycastBuffer buffer;
+	if (!m_pScene->raycast(PxVec3(origin.x, origin.y, origin.z), PxVec3(direction.x, direction.y, direction.z), maxDistance, buffer)) {
+		return false;
+	}
+
+	const PxRaycastHit& block = buffer.block;
+	hit.handle = GetActorHandle(block.actor);
+	hit.position = glm::vec3(block.position.x, block.position.y, block.position.z);
+	hit.normal = glm::vec3(block.normal.x, block.normal.y, block.normal.z);
+	hit.distance = block.distance;
+	return true;
+}
+
+size_t PhysXScene::OverlapSphere(glm::vec3 center, float radius, BodyHandle* pHandles, size_t maxCount, uint32_t layerMask)
+{
+	if (maxCount == 0) return 0;
+
+	m_overlapHits.resize(maxCount);
+	PxOverlapBuffer buffer(m_overlapHits.data(), static_cast<PxU32>(maxCount));
+	// Without blocking hits every body touching the sphere is reported
+	PxQueryFilterData filterData(PxQueryFlag::eSTATIC | PxQueryFlag::eDYNAMIC | PxQueryFlag::eNO_BLOCK);
+	m_pScene->overlap(PxSphereGeometry(radius), PxTransform(center.x, center.y, center.z), buffer, filterData);
+
+	for (PxU32 i = 0; i < buffer.getNbTouches(); i++)
+	{
+		pHandles[i] = GetActorHandle(buffer.getTouch(i).actor);
+	}
+	return buffer.getNbTouches();
+}
+
+bool PhysXScene::SweepBox(glm::vec3 center, glm::vec3 extents, glm::vec3 direction, float maxDistance, QueryHit& hit, uint32_t layerMask)
+{
+	hit.handle = BodyHandle::Invalid();
+
+	float length = glm::length(direction);
+	if (length == 0) return false;
+	direction /= length;
+
+	PxSweepBuffer buffer;
+	PxBoxGeometry boxGeo(extents.x, extents.y, extents.z);
+	if (!m_pScene->sweep(boxGeo, PxTransform(center.x, center.y, center.z), PxVec3(direction.x, direction.y, direction.z), maxDistance, buffer)) {
+		return false;
+	}
+
+	const PxSweepHit& block = buffer.block;
+	hit.handle = GetActorHandle(block.actor);
+	hit.position = glm::vec3(block.position.x, block.position.y, block.position.z);
+	hit.normal = glm::vec3(block.normal.x, block.normal.y, block.normal.z);
+	hit.distance = block.distance;
+	return true;
+}
+
+void PhysXScene::Despawn(float deltaTime)
+{
+	// Backwards, so the actor moved into a removed actor's place has already been checked
+	for (size_t i = m_pActors.size(); i-- > 0; )
+	{
+		m_actorAges[i] += deltaTime;
+		if (m_pActors[i]->isRigidDynamic() == nullptr) continue;
+
+		PxVec3 position = m_pActors[i]->getGlobalPose().p;
+		if (ShouldDespawn(m_actorAges[i], glm::vec3(position.x, position.y, position.z))) {
+			Remove(m_actorHandles[i]);
+		}
+	}
+}
+
 void PhysXScene::Update(float deltaTime)
 {
-	m_pScene->simulate(deltaTime);
-	while (m_pScene->fetchResults() == false) {
-		// TODO
+	m_profiler.BeginFrame();
+	m_profiler.GetStats().stepCount = 1;
+
+	{
+		ScopedPhaseTimer timer(m_profiler, StepPhase::Despawn);
+		Despawn(deltaTime);
+	}
+
+	// PhysX runs its phases internally, so only the step as a whole and what can be read from
+	//   the actors afterwards are recorded
+	{
+		ScopedPhaseTimer timer(m_profiler, StepPhase::Simulate);
+		m_pScene->simulate(deltaTime);
+		while (m_pScene->fetchResults() == false) {
+			// TODO
+		}
 	}
+
+	for (PxRigidActor* pActor : m_pActors)
+	{
+		PxRigidDynamic* pDynamic = pActor->isRigidDynamic();
+		if (pDynamic == nullptr) continue;
+
+		if (pDynamic->isSleeping()) {
+			m_profiler.GetStats().sleepingBodies++;
+		}
+		else {
+			m_profiler.GetStats().bodiesIntegrated++;
+		}
+	}
+
+	m_profiler.EndFrame();
 }
 
 void PhysXScene::Draw()
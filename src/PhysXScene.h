@@ -4,6 +4,7 @@
 
 #include <glm\vec3.hpp>
 #include <memory>
+#include <vector>
 
 // Fwd decls
 namespace physx{
@@ -12,7 +13,9 @@ namespace physx{
 	class PxErrorCallback;
 	class PxFoundation;
 	class PxMaterial;
+	struct PxOverlapHit;
 	class PxPhysics;
+	class PxActor;
 	class PxRigidActor;
 	class PxScene;
 	class PxShape;
@@ -35,15 +38,33 @@ public:
     void Update(float deltaTime) override;
     void Draw() override;
 
-	void AddPlaneStatic(glm::vec3 normal, float distance) override;
-	void AddSphereStatic(glm::vec3 position, float radius) override;
-	void AddAABBStatic(glm::vec3 position, glm::vec3 extents) override;
+	BodyHandle AddPlaneStatic(glm::vec3 normal, float distance) override;
+	BodyHandle AddSphereStatic(glm::vec3 position, float radius) override;
+	BodyHandle AddAABBStatic(glm::vec3 position, glm::vec3 extents) override;
 
-	void AddPlaneDynamic(glm::vec3 normal, float distance, float mass, glm::vec3 velocity) override;
-	void AddSphereDynamic(glm::vec3 position, float radius, float mass, glm::vec3 velocity) override;
-	void AddAABBDynamic(glm::vec3 position, glm::vec3 extents, float mass, glm::vec3 velocity) override;
+	BodyHandle AddPlaneDynamic(glm::vec3 normal, float distance, float mass, glm::vec3 velocity) override;
+	BodyHandle AddSphereDynamic(glm::vec3 position, float radius, float mass, glm::vec3 velocity) override;
+	BodyHandle AddAABBDynamic(glm::vec3 position, glm::vec3 extents, float mass, glm::vec3 velocity) override;
+
+	// The actors are handed to the PhysX scene together with addActors
+	void AddSpheresDynamic(size_t count, const glm::vec3* pPositions, const float* pRadii, const float* pMasses, const glm::vec3* pVelocities, BodyHandle* pHandles = nullptr) override;
+	void AddAABBsDynamic(size_t count, const glm::vec3* pPositions, const glm::vec3* pExtents, const float* pMasses, const glm::vec3* pVelocities, BodyHandle* pHandles = nullptr) override;
+
+	void Remove(BodyHandle handle) override;
+	size_t GetBodyCount() const override;
+
+	// Answered by the PhysX scene queries. PhysX has no collision layers, so the layer masks are ignored.
+	bool Raycast(glm::vec3 origin, glm::vec3 direction, float maxDistance, QueryHit& hit, uint32_t layerMask = AllQueryLayers) override;
+	size_t OverlapSphere(glm::vec3 center, float radius, BodyHandle* pHandles, size_t maxCount, uint32_t layerMask = AllQueryLayers) override;
+	bool SweepBox(glm::vec3 center, glm::vec3 extents, glm::vec3 direction, float maxDistance, QueryHit& hit, uint32_t layerMask = AllQueryLayers) override;
 
 private:
+	BodyHandle AddActor(physx::PxRigidActor* pActor);
+	// Gives the actor a handle without adding it to the PhysX scene
+	BodyHandle TrackActor(physx::PxRigidActor* pActor);
+	void AddActors(size_t count, physx::PxActor* const* ppActors, BodyHandle* pHandles);
+	BodyHandle GetActorHandle(const physx::PxRigidActor* pActor) const;
+	void Despawn(float deltaTime);
 	void AddWidget(physx::PxShape* shape, physx::PxRigidActor* actor, glm::vec4 geo_color);
 	void SetupVisualDebugger();
 
@@ -60,6 +81,15 @@ private:
 
 	physx::PxVisualDebuggerConnection* m_pConnection;
 
+	// Actors added through the BasePhysicsScene interface, kept packed like BodyStore
+	HandleTable m_handleTable;
+	std::vector<BodyHandle> m_actorHandles;
+	std::vector<physx::PxRigidActor*> m_pActors;
+	std::vector<float> m_actorAges;
+
+	// Space for the hits of OverlapSphere, which PhysX writes before they are turned into handles
+	std::vector<physx::PxOverlapHit> m_overlapHits;
+
 	std::unique_ptr<physx::PxAllocatorCallback> m_allocatorCallback;
 	std::unique_ptr<physx::PxErrorCallback> m_errorCallback;
 };
@@ -14,6 +14,7 @@
 #include "glm/gtc/quaternion.hpp"
 
 #include <functional>
+#include <vector>
 #include <PxPhysicsAPI.h>
 
 using namespace physx;
@@ -37,7 +38,16 @@ bool PhysicsApplication::startup()
     m_camera.sensitivity = 3;
 
     m_pRenderer = std::make_unique<Renderer>();
-	m_pPhysicsScene = std::make_unique<PhysicsScene>( glm::vec3(-70,0,0)) ;
+	// Zero uses every hardware thread. Only the custom scene uses the pool, PhysX has its own.
+	const unsigned int ThreadCount = 0;
+	m_pJobSystem = std::make_unique<JobSystem>(ThreadCount);
+
+	auto pPhysicsScene = std::make_unique<PhysicsScene>( glm::vec3(-70,0,0)) ;
+	pPhysicsScene->SetJobSystem(m_pJobSystem.get());
+	pPhysicsScene->SetShapeDrawer(&m_shapeDrawer);
+	pPhysicsScene->SetFixedTimestep(1 / 60.0f);
+	PhysicsScene& physicsScene = *pPhysicsScene;
+	m_pPhysicsScene = std::move(pPhysicsScene);
 	m_pPhysXScene = std::make_unique<PhysXScene>( glm::vec3(70, 0, 0) );
 
 
@@ -55,6 +65,18 @@ bool PhysicsApplication::startup()
 	CreateSpheres(m_pPhysXScene.get(), 20, 2);
 	CreateAABBs(m_pPhysXScene.get(), 20, 2.1f);
 
+	// Remove old bodies and ones that escape the table, so the emitter doesn't grow the scenes forever
+	const float DespawnAge = 30;
+	const Bounds DespawnBounds{ glm::vec3(-TableSize, -10, -TableSize), glm::vec3(TableSize, 100, TableSize) };
+	for (auto pScene : { m_pPhysicsScene.get(), m_pPhysXScene.get() })
+	{
+		pScene->SetDespawnAge(DespawnAge);
+		pScene->SetDespawnBounds(DespawnBounds);
+	}
+
+	// Started once the scene is set up
+	m_pSimulationThread = std::make_unique<SimulationThread>(physicsScene);
+
     m_lastFrameTime = (float)glfwGetTime();
 	m_emitTimer = 0;
 
@@ -82,6 +104,9 @@ bool PhysicsApplication::update()
 
 	m_emitTimer += deltaTime;
 
+	// The last step ran while the frame was drawn, it has to finish before the scene is changed
+	m_pSimulationThread->Wait();
+
 	if (m_emitTimer > 0.5f) {
 		float velX = m_velocityDistribution(m_generator);
 		float velY = m_velocityDistribution(m_generator);
@@ -115,7 +140,7 @@ bool PhysicsApplication::update()
 
     m_camera.update(deltaTime);
 
-	m_pPhysicsScene->Update(deltaTime);
+	m_pSimulationThread->Update(deltaTime);
 	m_pPhysXScene->Update(deltaTime);
 
 
@@ -166,27 +191,31 @@ void PhysicsApplication::CreateBoundary(BasePhysicsScene* pPhysicsScene, float t
 void PhysicsApplication::CreateSpheres(BasePhysicsScene* pPhysicsScene, int sphereCount, float spacing)
 {
 	auto randVel = std::bind(m_velocityDistribution, m_generator);
+	std::vector<glm::vec3> positions(sphereCount);
+	std::vector<float> radii(sphereCount);
+	std::vector<float> masses(sphereCount);
+	std::vector<glm::vec3> velocities(sphereCount);
 	for (int i = 0; i < sphereCount; i++) {
-        float mass = m_massDistribution(m_generator);
-		pPhysicsScene->AddSphereDynamic(
-			glm::vec3(-20 + i*spacing, 2 + i, -20 + i*spacing),		// Position
-			std::pow(mass,0.2f),								    // Radius
-			mass,                                                   // Mass 
-            glm::vec3(randVel(), 0, randVel())					    // Vel
-		);
+		masses[i] = m_massDistribution(m_generator);
+		positions[i] = glm::vec3(-20 + i*spacing, 2 + i, -20 + i*spacing);
+		radii[i] = std::pow(masses[i], 0.2f);
+		velocities[i] = glm::vec3(randVel(), 0, randVel());
 	}
 
+	pPhysicsScene->AddSpheresDynamic(sphereCount, positions.data(), radii.data(), masses.data(), velocities.data());
 }
 
 void PhysicsApplication::CreateAABBs(BasePhysicsScene* pPhysicsScene, int aabbCount, float spacing)
 {
 	auto randVel = std::bind(m_velocityDistribution, m_generator);
+	std::vector<glm::vec3> positions(aabbCount);
+	std::vector<glm::vec3> extents(aabbCount, glm::vec3(1, 1, 1));
+	std::vector<float> masses(aabbCount, 1);
+	std::vector<glm::vec3> velocities(aabbCount);
 	for (int i = 0; i < aabbCount; i++) {
-		pPhysicsScene->AddAABBDynamic(
-			glm::vec3(-20 + i*spacing, 6 + i, -20 + i*spacing),	// Position
-			glm::vec3(1, 1, 1),									// Extents
-			1, glm::vec3(randVel(), 0, randVel())					// mass,vel
-		);
+		positions[i] = glm::vec3(-20 + i*spacing, 6 + i, -20 + i*spacing);
+		velocities[i] = glm::vec3(randVel(), 0, randVel());
 	}
 
+	pPhysicsScene->AddAABBsDynamic(aabbCount, positions.data(), extents.data(), masses.data(), velocities.data());
 }
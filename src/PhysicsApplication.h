@@ -4,7 +4,10 @@
 #include "Application.h"
 #include "BasePhysicsScene.h"
 #include "Camera.h"
+#include "GizmoShapeDrawer.h"
+#include "JobSystem.h"
 #include "Render.h"
+#include "SimulationThread.h"
 
 #include <memory>
 #include <random>
@@ -26,8 +29,13 @@ public:
 
     void renderGizmos(physx::PxScene* physics_scene);
 
+	// Declared before the scenes so they outlive them
+	std::unique_ptr<JobSystem> m_pJobSystem;
+	GizmoShapeDrawer m_shapeDrawer;
 	std::unique_ptr<BasePhysicsScene> m_pPhysicsScene;
 	std::unique_ptr<BasePhysicsScene> m_pPhysXScene;
+	// Steps m_pPhysicsScene while the frame is drawn. Declared after it, so it stops first.
+	std::unique_ptr<SimulationThread> m_pSimulationThread;
     std::unique_ptr<Renderer> m_pRenderer;
 
     FlyCamera m_camera;
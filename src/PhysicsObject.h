@@ -1,45 +1,46 @@
 #pragma once
 
-#include "RigidBody.h"
+#include "BodyStore.h"
 #include "Shapes.h"
 
-#include <memory>
-#include <glm\vec3.hpp>
+#include <glm/vec3.hpp>
 
+// A view of one body in a BodyStore.
+// It's cheap to make and holds no state of its own, the store owns the body.
 class PhysicsObject
 {
 public:
-    PhysicsObject(glm::vec3 initialPosition, Shape* pShape, RigidBody* pRigidBody = nullptr) :
-        m_position(initialPosition),
-        m_pShape(pShape),
-        m_pRigidBody(pRigidBody)
+    PhysicsObject(BodyStore* pBodies, BodyHandle handle) :
+        m_pBodies(pBodies),
+        m_handle(handle)
     {}
 
-    glm::vec3 GetPosition() const { return m_position; }
-    glm::vec3 GetVelocity() const;
-	const Shape* GetShape() const { return m_pShape.get(); }
-	float GetMass() const;
+	BodyHandle GetHandle() const { return m_handle; }
+
+    glm::vec3 GetPosition() const { return m_pBodies->GetPosition(m_handle); }
+    glm::vec3 GetVelocity() const { return m_pBodies->GetVelocity(m_handle); }
+	const Shape* GetShape() const { return m_pBodies->GetShape(m_handle); }
+	float GetMass() const { return m_pBodies->GetMass(m_handle); }
 	glm::vec3 GetMomentum() const { return GetMass() * GetVelocity(); }
+	bool IsStatic() const { return m_pBodies->IsStatic(m_handle); }
+	bool IsAwake() const { return m_pBodies->IsAwake(m_handle); }
 
-	void Translate(glm::vec3 positionDelta);
-	void AddVelocity(glm::vec3 velocity) { if (m_pRigidBody != nullptr) m_pRigidBody->AddVelocity(velocity); }
-	void AddMomentum(glm::vec3 momentum) { if (m_pRigidBody != nullptr) m_pRigidBody->AddMomentum(momentum); }
-	void AddForce(glm::vec3 force) { if (m_pRigidBody != nullptr) m_pRigidBody->AddForce(force); }
+	void Translate(glm::vec3 positionDelta) { m_pBodies->Translate(m_handle, positionDelta); }
+	void AddVelocity(glm::vec3 velocity) { m_pBodies->AddVelocity(m_handle, velocity); }
+	void AddMomentum(glm::vec3 momentum) { AddVelocity(momentum * m_pBodies->GetInverseMass(m_handle)); }
+	void AddForce(glm::vec3 force) { m_pBodies->AddForce(m_handle, force); }
 
-    void Update( float deltaTime, glm::vec3 gravity );
-    void Draw() { m_pShape->Draw(m_position); };
+    void Draw(ShapeDrawer& drawer) { GetShape()->Draw(drawer, GetPosition()); };
 
 
 	void Stop() {
-		if (m_pRigidBody != nullptr) m_pRigidBody->Stop();
+		m_pBodies->Stop(m_handle);
 	}
 
 	template<typename T>
 	const T* GetShape() const { return static_cast<const T*>(GetShape()); }
 
 private:
-    glm::vec3 m_position;
-
-    std::unique_ptr<Shape> m_pShape;
-    std::unique_ptr<RigidBody> m_pRigidBody;
+	BodyStore* m_pBodies;
+	BodyHandle m_handle;
 };
@@ -1,102 +1,1052 @@
 #include "PhysicsScene.h"
 
+#include "AABBTreeBroadphase.h"
 #include "Collision.h"
+#include "CollisionDispatch.h"
+#include "IntegrationKernel.h"
+#include "Islands.h"
+#include "JobSystem.h"
+#include "MappedFile.h"
 #include "PhysicsObject.h"
 #include"RigidBody.h"
+#include "SimulationRecorder.h"
+#include "SweepAndPrune.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <glm/glm.hpp>
 
-void PhysicsScene::AddPlaneStatic(glm::vec3 normal, float distance)
+
+constexpr float PhysicsScene::DefaultSleepVelocity;
+constexpr float PhysicsScene::DefaultSweepMotionFraction;
+
+
+PhysicsScene::PhysicsScene(glm::vec3 offset) :
+	m_offset(offset)
+{
+	SetBroadphase(BroadphaseType::SweepAndPrune);
+}
+
+void PhysicsScene::SetBroadphase(BroadphaseType type)
+{
+	m_broadphaseType = type;
+
+	switch (type)
+	{
+	case BroadphaseType::BruteForce:
+		m_pBroadphase.reset();
+		break;
+	case BroadphaseType::SweepAndPrune:
+		m_pBroadphase = std::make_unique<SweepAndPrune>();
+		break;
+	case BroadphaseType::SpatialHash:
+		m_pBroadphase = std::make_unique<SpatialHash>(m_spatialHashCellSize);
+		break;
+	case BroadphaseType::AABBTree:
+		m_pBroadphase = std::make_unique<AABBTreeBroadphase>();
+		break;
+	}
+
+	const BodyHandle* handles = m_bodies.GetHandles();
+	for (size_t i = 0; i < m_bodies.GetCount(); i++)
+	{
+		AddToBroadphase(handles[i]);
+	}
+}
+
+void PhysicsScene::SetSpatialHashCellSize(float cellSize)
+{
+	m_spatialHashCellSize = cellSize;
+	if (m_broadphaseType == BroadphaseType::SpatialHash) {
+		static_cast<SpatialHash*>(m_pBroadphase.get())->SetCellSize(cellSize);
+	}
+}
+
+const SpatialHash::Stats* PhysicsScene::GetSpatialHashStats() const
+{
+	if (m_broadphaseType != BroadphaseType::SpatialHash) return nullptr;
+	return &static_cast<const SpatialHash*>(m_pBroadphase.get())->GetStats();
+}
+
+void PhysicsScene::AddToBroadphase(BodyHandle handle)
+{
+	if (m_pBroadphase == nullptr) return;
+
+	// Sleeping bodies are static in the broadphase until they wake
+	m_pBroadphase->Add(handle.index, m_bodies.GetBounds(handle), !m_bodies.IsAwake(handle));
+}
+
+void PhysicsScene::AddToQueryTree(BodyHandle handle)
+{
+	if (m_pQueryTree == nullptr) return;
+
+	m_pQueryTree->Add(handle.index, m_bodies.GetBounds(handle), m_bodies.IsStatic(handle));
+}
+
+const AABBTreeBroadphase& PhysicsScene::UpdateQueryTree()
+{
+	if (m_pQueryTree == nullptr) {
+		m_pQueryTree = std::make_unique<AABBTreeBroadphase>();
+		const BodyHandle* handles = m_bodies.GetHandles();
+		for (size_t i = 0; i < m_bodies.GetCount(); i++)
+		{
+			AddToQueryTree(handles[i]);
+		}
+	}
+	else if (m_isQueryTreeStale) {
+		// Bodies that fell asleep moved in the step they did, so they're updated too.
+		// Most haven't left their leaf's fat bounds, which is quick to check.
+		const BodyHandle* handles = m_bodies.GetHandles();
+		for (size_t i = m_bodies.GetPartitionBegin(BodyStore::MotionType::Kinematic); i < m_bodies.GetCount(); i++)
+		{
+			m_pQueryTree->Update(handles[i].index, m_bodies.GetBoundsAt(i));
+		}
+	}
+
+	m_isQueryTreeStale = false;
+	return *m_pQueryTree;
+}
+
+bool PhysicsScene::Raycast(glm::vec3 origin, glm::vec3 direction, float maxDistance, QueryHit& hit, uint32_t layerMask)
+{
+	return CastBox(UpdateQueryTree(), origin, glm::vec3(0), direction, maxDistance, layerMask, hit);
+}
+
+bool PhysicsScene::SweepBox(glm::vec3 center, glm::vec3 extents, glm::vec3 direction, float maxDistance, QueryHit& hit, uint32_t layerMask)
+{
+	return CastBox(UpdateQueryTree(), center, extents, direction, maxDistance, layerMask, hit);
+}
+
+bool PhysicsScene::CastBox(const AABBTreeBroadphase& queryTree, glm::vec3 origin, glm::vec3 extents, glm::vec3 direction, float maxDistance, uint32_t layerMask, QueryHit& hit) const
 {
-	AddPlane(normal, distance);
+	hit.handle = BodyHandle::Invalid();
+
+	float length = glm::length(direction);
+	if (length == 0) return false;
+	direction /= length;
+	origin += m_offset;
+
+	// A ray is a box without any extents
+	const bool isRay = extents == glm::vec3(0);
+	const uint32_t* layers = m_bodies.GetCollisionLayers();
+
+	queryTree.BoxCast(origin, extents, direction, maxDistance, [&](uint32_t slot, float maxHitDistance) {
+		BodyHandle handle = m_bodies.GetHandleFromSlot(slot);
+		size_t index = m_bodies.GetIndex(handle);
+		if ((layers[index] & layerMask) == 0) return maxHitDistance;
+
+		QueryHit bodyHit;
+		bool isHit = isRay ?
+			Collision::Raycast(m_bodies.GetShape(handle), m_bodies.GetPosition(handle), origin, direction, maxHitDistance, bodyHit) :
+			Collision::SweepBox(m_bodies.GetShape(handle), m_bodies.GetPosition(handle), origin, extents, direction, maxHitDistance, bodyHit);
+		if (!isHit) return maxHitDistance;
+
+		hit = bodyHit;
+		hit.handle = handle;
+		hit.position -= m_offset;
+		// Only closer bodies are tested after this, a distance of 0 ends the cast
+		return bodyHit.distance;
+	});
+
+	return hit.IsHit();
 }
 
-void PhysicsScene::AddSphereStatic(glm::vec3 position, float radius)
+size_t PhysicsScene::OverlapSphere(glm::vec3 center, float radius, BodyHandle* pHandles, size_t maxCount, uint32_t layerMask)
 {
-	AddSphere(position, radius);
+	const AABBTreeBroadphase& queryTree = UpdateQueryTree();
+	if (maxCount == 0) return 0;
+
+	center += m_offset;
+	const uint32_t* layers = m_bodies.GetCollisionLayers();
+
+	size_t count = 0;
+	queryTree.Query(Bounds{ center - radius, center + radius }, [&](uint32_t slot) {
+		BodyHandle handle = m_bodies.GetHandleFromSlot(slot);
+		size_t index = m_bodies.GetIndex(handle);
+		if ((layers[index] & layerMask) != 0 && Collision::OverlapSphere(m_bodies.GetShape(handle), m_bodies.GetPosition(handle), center, radius)) {
+			pHandles[count++] = handle;
+		}
+		return count < maxCount;
+	});
+
+	return count;
 }
 
-void PhysicsScene::AddAABBStatic(glm::vec3 position, glm::vec3 extents)
+void PhysicsScene::RaycastBatch(const RaycastQuery* pQueries, size_t count, QueryHit* pHits)
 {
-	AddAABB(position, extents);
+	// Enough rays per job to be worth handing to another thread
+	const size_t RaysPerJob = 64;
+
+	// Brought up to date once, then only read
+	const AABBTreeBroadphase& queryTree = UpdateQueryTree();
+	auto castRays = [&](size_t begin, size_t end, unsigned int) {
+		for (size_t i = begin; i < end; i++)
+		{
+			const RaycastQuery& query = pQueries[i];
+			CastBox(queryTree, query.origin, glm::vec3(0), query.direction, query.maxDistance, query.layerMask, pHits[i]);
+		}
+	};
+
+	if (m_pJobSystem != nullptr) {
+		m_pJobSystem->ParallelFor(count, RaysPerJob, castRays);
+	}
+	else {
+		castRays(0, count, 0);
+	}
+}
+
+BodyHandle PhysicsScene::AddPlaneStatic(glm::vec3 normal, float distance)
+{
+	return AddPlane(normal, distance);
 }
 
+BodyHandle PhysicsScene::AddSphereStatic(glm::vec3 position, float radius)
+{
+	return AddSphere(position, radius);
+}
 
-void PhysicsScene::AddPlaneDynamic(glm::vec3 normal, float distance, float mass, glm::vec3 velocity)
+BodyHandle PhysicsScene::AddAABBStatic(glm::vec3 position, glm::vec3 extents)
 {
-	AddPlane(normal, distance, new RigidBody(mass, velocity));
+	return AddAABB(position, extents);
 }
 
-void PhysicsScene::AddSphereDynamic(glm::vec3 position, float radius, float mass, glm::vec3 velocity)
+
+BodyHandle PhysicsScene::AddPlaneDynamic(glm::vec3 normal, float distance, float mass, glm::vec3 velocity)
 {
-	AddSphere(position, radius, new RigidBody(mass, velocity));
+	RigidBody rigidBody(mass, velocity);
+	return AddPlane(normal, distance, &rigidBody);
 }
 
-void PhysicsScene::AddAABBDynamic(glm::vec3 position, glm::vec3 extents, float mass, glm::vec3 velocity)
+BodyHandle PhysicsScene::AddSphereDynamic(glm::vec3 position, float radius, float mass, glm::vec3 velocity)
 {
-	AddAABB(position, extents, new RigidBody(mass, velocity));
+	RigidBody rigidBody(mass, velocity);
+	return AddSphere(position, radius, &rigidBody);
 }
 
-void PhysicsScene::AddPlane(glm::vec3 normal, float distance, RigidBody* pRigidBody)
+BodyHandle PhysicsScene::AddAABBDynamic(glm::vec3 position, glm::vec3 extents, float mass, glm::vec3 velocity)
 {
-	auto pPlane = std::make_shared<PhysicsObject>(
+	RigidBody rigidBody(mass, velocity);
+	return AddAABB(position, extents, &rigidBody);
+}
+
+void PhysicsScene::AddSpheresDynamic(size_t count, const glm::vec3* pPositions, const float* pRadii, const float* pMasses, const glm::vec3* pVelocities, BodyHandle* pHandles)
+{
+	std::vector<Shape*> pShapes(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		pShapes[i] = m_bodies.CreateShape<Sphere>(pRadii[i]);
+	}
+	AddBodiesDynamic(count, pPositions, pShapes.data(), pMasses, pVelocities, pHandles);
+}
+
+void PhysicsScene::AddAABBsDynamic(size_t count, const glm::vec3* pPositions, const glm::vec3* pExtents, const float* pMasses, const glm::vec3* pVelocities, BodyHandle* pHandles)
+{
+	std::vector<Shape*> pShapes(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		pShapes[i] = m_bodies.CreateShape<AABB>(pExtents[i]);
+	}
+	AddBodiesDynamic(count, pPositions, pShapes.data(), pMasses, pVelocities, pHandles);
+}
+
+BodyHandle PhysicsScene::AddSphereKinematic(glm::vec3 position, float radius, glm::vec3 velocity)
+{
+	BodyHandle handle = m_bodies.AddKinematic(position + m_offset, m_bodies.CreateShape<Sphere>(radius), velocity);
+	AddToBroadphase(handle);
+	AddToQueryTree(handle);
+	return handle;
+}
+
+BodyHandle PhysicsScene::AddAABBKinematic(glm::vec3 position, glm::vec3 extents, glm::vec3 velocity)
+{
+	BodyHandle handle = m_bodies.AddKinematic(position + m_offset, m_bodies.CreateShape<AABB>(extents), velocity);
+	AddToBroadphase(handle);
+	AddToQueryTree(handle);
+	return handle;
+}
+
+BodyHandle PhysicsScene::AddPlane(glm::vec3 normal, float distance, const RigidBody* pRigidBody)
+{
+	return AddBody(
 		glm::vec3(0),				// Position, not used for plane
-		new Plane(normal, distance), // Normal and distance
+		m_bodies.CreateShape<Plane>(normal, distance), // Normal and distance
 		pRigidBody
 		);
-	AddObject(pPlane);
 }
 
-void PhysicsScene::AddSphere(glm::vec3 position, float radius, RigidBody* pRigidBody)
+BodyHandle PhysicsScene::AddSphere(glm::vec3 position, float radius, const RigidBody* pRigidBody)
+{
+	return AddBody(position, m_bodies.CreateShape<Sphere>(radius), pRigidBody);
+}
+
+BodyHandle PhysicsScene::AddAABB(glm::vec3 position, glm::vec3 extents, const RigidBody* pRigidBody)
+{
+	return AddBody(position, m_bodies.CreateShape<AABB>(extents), pRigidBody);
+}
+
+BodyHandle PhysicsScene::AddBody(glm::vec3 position, Shape* pShape, const RigidBody* pRigidBody)
+{
+	BodyHandle handle = m_bodies.Add(position + m_offset, pShape, pRigidBody);
+	AddToBroadphase(handle);
+	AddToQueryTree(handle);
+	return handle;
+}
+
+void PhysicsScene::AddBodiesDynamic(size_t count, const glm::vec3* pPositions, Shape* const* ppShapes, const float* pMasses, const glm::vec3* pVelocities, BodyHandle* pHandles)
+{
+	std::vector<glm::vec3> positions(pPositions, pPositions + count);
+	for (glm::vec3& position : positions)
+	{
+		position += m_offset;
+	}
+
+	size_t begin = m_bodies.GetCount();
+	m_bodies.AddDynamic(count, positions.data(), ppShapes, pMasses, pVelocities);
+
+	const BodyHandle* handles = m_bodies.GetHandles() + begin;
+	for (size_t i = 0; i < count; i++)
+	{
+		AddToBroadphase(handles[i]);
+		AddToQueryTree(handles[i]);
+	}
+
+	if (pHandles != nullptr) {
+		std::copy(handles, handles + count, pHandles);
+	}
+}
+
+void PhysicsScene::Remove(BodyHandle handle)
+{
+	if (!m_bodies.IsValid(handle)) return;
+
+	if (m_pBroadphase != nullptr) {
+		m_pBroadphase->Remove(handle.index);
+	}
+	if (m_pQueryTree != nullptr) {
+		m_pQueryTree->Remove(handle.index);
+	}
+	m_bodies.Remove(handle);
+}
+
+size_t PhysicsScene::GetBodyCount() const
+{
+	return m_bodies.GetCount();
+}
+
+void PhysicsScene::SaveSnapshot(std::vector<uint8_t>& data) const
+{
+	data.clear();
+	SnapshotWriter writer(data);
+	writer.Write(SnapshotHeader{ SnapshotHeader::Magic, SnapshotHeader::Version, 0 });
+
+	writer.Write(m_accumulatedTime);
+	m_bodies.Save(writer);
+	m_contactSolver.SaveCache(writer);
+
+	uint64_t size = data.size();
+	memcpy(&data[offsetof(SnapshotHeader, size)], &size, sizeof(size));
+}
+
+bool PhysicsScene::SaveSnapshot(const char* pPath) const
+{
+	std::vector<uint8_t> data;
+	SaveSnapshot(data);
+
+	FILE* pFile = fopen(pPath, "wb");
+	if (pFile == nullptr) return false;
+
+	bool isWritten = fwrite(data.data(), 1, data.size(), pFile) == data.size();
+	return fclose(pFile) == 0 && isWritten;
+}
+
+bool PhysicsScene::RestoreSnapshot(const void* pData, size_t size)
+{
+	SnapshotReader reader(pData, size);
+	SnapshotHeader header;
+	if (!reader.Read(header) || header.magic != SnapshotHeader::Magic || header.version != SnapshotHeader::Version || header.size != size) return false;
+
+	// The bodies are read into a new store, so the scene is only changed once all of it has been read
+	float accumulatedTime;
+	BodyStore bodies;
+	if (!reader.Read(accumulatedTime) || !bodies.Restore(reader) || !m_contactSolver.RestoreCache(reader)) return false;
+
+	m_accumulatedTime = accumulatedTime;
+	m_bodies = std::move(bodies);
+	m_broadphasePairs.clear();
+	m_contacts.clear();
+	m_pQueryTree.reset();
+
+	// Rebuilt around the restored bodies
+	SetBroadphase(m_broadphaseType);
+	return true;
+}
+
+bool PhysicsScene::RestoreSnapshot(const char* pPath)
+{
+	MappedFile file;
+	return file.Open(pPath) && RestoreSnapshot(file.GetData(), file.GetSize());
+}
+
+void PhysicsScene::SetFixedTimestep(float timestep, int maxSubsteps)
 {
-	auto pSphere = std::make_shared<PhysicsObject>(position, new Sphere(radius), pRigidBody);
-	AddObject(pSphere);
+	m_fixedTimestep = timestep;
+	m_maxSubsteps = std::max(maxSubsteps, 1);
+	m_accumulatedTime = 0;
 }
 
-void PhysicsScene::AddAABB(glm::vec3 position, glm::vec3 extents, RigidBody* pRigidBody)
+void PhysicsScene::SetSleepThreshold(float velocity, uint16_t stepCount)
 {
-	auto pBox = std::make_shared<PhysicsObject>(position, new AABB(extents), pRigidBody);
-	AddObject(pBox);
+	m_sleepVelocity = velocity;
+	m_sleepSteps = stepCount;
 }
 
-void PhysicsScene::AddObject(std::shared_ptr<PhysicsObject> pPhysicsObject)
+size_t PhysicsScene::GetAwakeBodyCount() const
 {
-	pPhysicsObject->Translate(m_offset);
-    m_pPhysicsObjects.push_back(pPhysicsObject);
-};
+	const uint8_t* isAwake = m_bodies.GetAwakeFlags();
+	return std::count(isAwake, isAwake + m_bodies.GetCount(), 1);
+}
 
 void PhysicsScene::Update(float deltaTime)
 {
-	const float DampingCoeffecient = 0.2f;
+	m_profiler.BeginFrame();
+
+	if (m_fixedTimestep <= 0) {
+		m_bodies.SavePreviousPositions();
+		Step(deltaTime);
+	}
+	else {
+		m_accumulatedTime += deltaTime;
+		int substepCount = std::min(static_cast<int>(m_accumulatedTime / m_fixedTimestep), m_maxSubsteps);
+
+		for (int i = 0; i < substepCount; i++)
+		{
+			// Draw interpolates from the state before the last step
+			if (i == substepCount - 1) {
+				m_bodies.SavePreviousPositions();
+			}
+
+			Step(m_fixedTimestep);
+			m_accumulatedTime -= m_fixedTimestep;
+		}
 
-	for (auto& pPhysicsObject : m_pPhysicsObjects)
+		// Drop the whole steps that didn't fit
+		if (substepCount == m_maxSubsteps) {
+			m_accumulatedTime = std::fmod(m_accumulatedTime, m_fixedTimestep);
+		}
+	}
+
+	const size_t dynamicBegin = m_bodies.GetPartitionBegin(BodyStore::MotionType::Dynamic);
+	const uint8_t* isAwake = m_bodies.GetAwakeFlags();
+	m_profiler.GetStats().sleepingBodies = std::count(isAwake + dynamicBegin, isAwake + m_bodies.GetCount(), 0);
+	m_profiler.EndFrame();
+
+	PublishDrawState();
+}
+
+void PhysicsScene::Step(float deltaTime)
+{
+	m_profiler.GetStats().stepCount++;
+
+	// Bodies pushed since the last step
 	{
-		pPhysicsObject->AddForce(DampingCoeffecient * -pPhysicsObject->GetVelocity() * deltaTime);
+		ScopedPhaseTimer timer(m_profiler, StepPhase::Wake);
+		WakeIslands();
 	}
 
-    for (auto& pPhysicsObject : m_pPhysicsObjects)
-    {
-        pPhysicsObject->Update(deltaTime, m_gravity);
-    }
+	Integrate(deltaTime);
+
+	{
+		ScopedPhaseTimer timer(m_profiler, StepPhase::Despawn);
+		Despawn(deltaTime);
+	}
 
 	CheckCollisions();
+
+	{
+		ScopedPhaseTimer timer(m_profiler, StepPhase::Sleeping);
+		UpdateSleeping();
+	}
+
+	m_isQueryTreeStale = true;
+
+	if (m_pRecorder != nullptr) {
+		m_pRecorder->Record(m_bodies.GetCount(), m_bodies.GetHandles(), m_bodies.GetPositions(), m_bodies.GetVelocities());
+	}
+}
+
+void PhysicsScene::PublishDrawState()
+{
+	if (m_pShapeDrawer == nullptr) return;
+
+	// How far between the last two steps the time left over is
+	const float alpha = m_fixedTimestep > 0 ? m_accumulatedTime / m_fixedTimestep : 1;
+
+	std::vector<DrawnBody>& drawnBodies = m_drawStates.GetBackBuffer();
+	drawnBodies.resize(m_bodies.GetCount());
+
+	const BodyHandle* handles = m_bodies.GetHandles();
+	const glm::vec3* positions = m_bodies.GetPositions();
+	const glm::vec3* previousPositions = m_bodies.GetPreviousPositions();
+	for (size_t i = 0; i < m_bodies.GetCount(); i++)
+	{
+		const Shape* pShape = m_bodies.GetShape(handles[i]);
+		DrawnBody& drawnBody = drawnBodies[i];
+		drawnBody.shapeID = static_cast<Shape::ID>(pShape->GetID());
+		drawnBody.position = glm::mix(previousPositions[i], positions[i], alpha);
+
+		switch (drawnBody.shapeID)
+		{
+		case Shape::ID::Plane:
+			drawnBody.size = static_cast<const Plane*>(pShape)->GetNormal();
+			drawnBody.distance = static_cast<const Plane*>(pShape)->GetDistance();
+			break;
+		case Shape::ID::Sphere:
+			drawnBody.size = glm::vec3(static_cast<const Sphere*>(pShape)->GetRadius(), 0, 0);
+			break;
+		case Shape::ID::AABB:
+			drawnBody.size = static_cast<const AABB*>(pShape)->GetExtents();
+			break;
+		default:
+			break;
+		}
+	}
+
+	m_drawStates.Publish();
 }
 
 void PhysicsScene::Draw()
 {
-    for (auto& pPhysicsObject : m_pPhysicsObjects)
-    {
-        pPhysicsObject->Draw();
-    }
+	if (m_pShapeDrawer == nullptr) return;
+
+	// Keeps drawing the last state if no Update has finished since
+	m_drawStates.SwapFront();
+
+	for (const DrawnBody& drawnBody : m_drawStates.GetFrontBuffer())
+	{
+		switch (drawnBody.shapeID)
+		{
+		case Shape::ID::Plane:
+			m_pShapeDrawer->DrawPlane(drawnBody.position, drawnBody.size, drawnBody.distance);
+			break;
+		case Shape::ID::Sphere:
+			m_pShapeDrawer->DrawSphere(drawnBody.position, drawnBody.size.x);
+			break;
+		case Shape::ID::AABB:
+			m_pShapeDrawer->DrawAABB(drawnBody.position, drawnBody.size);
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+void PhysicsScene::Integrate(float deltaTime)
+{
+	const float DampingCoeffecient = 0.2f;
+	// Enough bodies per job to be worth handing to another thread
+	const size_t BodiesPerJob = 4096;
+
+	ScopedPhaseTimer timer(m_profiler, StepPhase::Integrate);
+	const size_t bodyCount = m_bodies.GetCount();
+	const size_t kinematicBegin = m_bodies.GetPartitionBegin(BodyStore::MotionType::Kinematic);
+	const size_t dynamicBegin = m_bodies.GetPartitionBegin(BodyStore::MotionType::Dynamic);
+	glm::vec3* positions = m_bodies.GetPositions();
+	glm::vec3* velocities = m_bodies.GetVelocities();
+
+	// Kinematic bodies aren't affected by forces or gravity
+	for (size_t i = kinematicBegin; i < dynamicBegin; i++)
+	{
+		positions[i] += velocities[i] * deltaTime;
+	}
+
+	// Displacements are only needed to find the bodies to sweep
+	const bool isSweeping = m_sweepMotionFraction > 0;
+	if (isSweeping) m_displacements.resize(bodyCount);
+
+	IntegrationBatch batch;
+	batch.positions = positions;
+	batch.velocities = velocities;
+	batch.forces = m_bodies.GetForces();
+	batch.inverseMasses = m_bodies.GetInverseMasses();
+	batch.isAwake = m_bodies.GetAwakeFlags();
+	batch.displacements = isSweeping ? m_displacements.data() : nullptr;
+	batch.deltaTime = deltaTime;
+	batch.dampingCoefficient = DampingCoeffecient;
+	batch.gravity = m_gravity;
+
+	// Each job gathers the bodies to sweep from its own range, they're joined in order after,
+	//   so the result doesn't depend on how the ranges were shared between threads
+	const size_t dynamicCount = bodyCount - dynamicBegin;
+	const size_t chunkCount = (dynamicCount + BodiesPerJob - 1) / BodiesPerJob;
+	if (m_sweptBodyChunks.size() < chunkCount) m_sweptBodyChunks.resize(chunkCount);
+	for (size_t chunk = 0; chunk < chunkCount; chunk++)
+	{
+		m_sweptBodyChunks[chunk].clear();
+	}
+
+	const BodyHandle* handles = m_bodies.GetHandles();
+	const int* shapeIDs = m_bodies.GetShapeIDs();
+	const glm::vec3* halfExtents = m_bodies.GetHalfExtents();
+	const int sphereID = static_cast<int>(Shape::ID::Sphere);
+
+	std::atomic<size_t> integratedCount(dynamicBegin - kinematicBegin);
+	auto integrate = [&](size_t begin, size_t end, unsigned int) {
+		integratedCount += IntegrateBodies(batch, dynamicBegin + begin, dynamicBegin + end);
+		if (!isSweeping) return;
+
+		std::vector<SweptBody>& sweptBodies = m_sweptBodyChunks[begin / BodiesPerJob];
+		for (size_t i = dynamicBegin + begin; i < dynamicBegin + end; i++)
+		{
+			// A sphere's half extents are its radius
+			glm::vec3 displacement = m_displacements[i];
+			float sweepDistance = m_sweepMotionFraction * halfExtents[i].x;
+			if (shapeIDs[i] == sphereID && glm::dot(displacement, displacement) > sweepDistance * sweepDistance) {
+				sweptBodies.push_back(SweptBody{ handles[i], displacement, 1 });
+			}
+		}
+	};
+
+	if (m_pJobSystem != nullptr) {
+		m_pJobSystem->ParallelFor(dynamicCount, BodiesPerJob, integrate);
+	}
+	else if (dynamicCount > 0) {
+		integrate(0, dynamicCount, 0);
+	}
+
+	m_sweptBodies.clear();
+	for (size_t chunk = 0; chunk < chunkCount; chunk++)
+	{
+		m_sweptBodies.insert(m_sweptBodies.end(), m_sweptBodyChunks[chunk].begin(), m_sweptBodyChunks[chunk].end());
+	}
+
+	m_profiler.GetStats().bodiesIntegrated += integratedCount;
+}
+
+void PhysicsScene::Despawn(float deltaTime)
+{
+	float* ages = m_bodies.GetAges();
+	const glm::vec3* positions = m_bodies.GetPositions();
+
+	for (size_t i = 0; i < m_bodies.GetCount(); i++)
+	{
+		ages[i] += deltaTime;
+	}
+
+	// Backwards, so the body moved into a removed body's place has already been checked.
+	// Only dynamic bodies despawn, they're the last partition so removing one only moves
+	//   another dynamic body.
+	const size_t dynamicBegin = m_bodies.GetPartitionBegin(BodyStore::MotionType::Dynamic);
+	for (size_t i = m_bodies.GetCount(); i-- > dynamicBegin; )
+	{
+		if (ShouldDespawn(ages[i], positions[i] - m_offset)) {
+			Remove(m_bodies.GetHandles()[i]);
+		}
+	}
 }
 
 void PhysicsScene::CheckCollisions()
 {
-    for (auto it1 = std::begin(m_pPhysicsObjects); it1 != std::end(m_pPhysicsObjects); it1++)
-    {
-        for (auto it2 = std::next(it1); it2 != std::end(m_pPhysicsObjects); it2++)
-        {
-			Collision::Detect(it1->get(), it2->get());
-        }
-    }
+	{
+		ScopedPhaseTimer timer(m_profiler, StepPhase::Broadphase);
+
+		m_broadphasePairs.clear();
+		if (m_pBroadphase == nullptr) {
+			FindPairsBruteForce();
+		}
+		else {
+			const BodyHandle* handles = m_bodies.GetHandles();
+			const uint8_t* isAwake = m_bodies.GetAwakeFlags();
+			// Static and sleeping bodies haven't moved
+			for (size_t i = m_bodies.GetPartitionBegin(BodyStore::MotionType::Kinematic); i < m_bodies.GetCount(); i++)
+			{
+				if (!isAwake[i]) continue;
+
+				m_pBroadphase->Update(handles[i].index, m_bodies.GetBoundsAt(i));
+			}
+
+			UpdateSweptBounds();
+			m_pBroadphase->FindPairs(m_broadphasePairs);
+		}
+
+		FilterPairs();
+
+		// Sorted so results don't depend on the broadphase
+		std::sort(std::begin(m_broadphasePairs), std::end(m_broadphasePairs),
+			[](const BroadphasePair& pair1, const BroadphasePair& pair2) { return pair1.GetKey() < pair2.GetKey(); });
+	}
+
+	if (!m_sweptBodies.empty()) {
+		ScopedPhaseTimer timer(m_profiler, StepPhase::Continuous);
+		SweepFastBodies();
+	}
+
+	{
+		ScopedPhaseTimer timer(m_profiler, StepPhase::Narrowphase);
+
+		BucketPairs();
+		if (m_isNarrowphaseBatched) {
+			FilterBatches();
+		}
+		FindContacts();
+	}
+
+	ScopedPhaseTimer timer(m_profiler, StepPhase::Solver);
+
+	// Sleeping bodies that were hit wake, along with their islands
+	for (const Contact& contact : m_contacts)
+	{
+		m_bodies.Wake(contact.handle1);
+		m_bodies.Wake(contact.handle2);
+	}
+	WakeIslands();
+
+	m_contactSolver.Solve(m_bodies, m_contacts, m_pJobSystem);
+}
+
+void PhysicsScene::BucketPairs()
+{
+	for (auto& buckets : m_pairBuckets)
+	{
+		for (auto& pairs : buckets)
+		{
+			pairs.clear();
+		}
+	}
+
+	const int* shapeIDs = m_bodies.GetShapeIDs();
+
+	// Kept in broadphase order within each bucket
+	for (const auto& pair : m_broadphasePairs)
+	{
+		BodyHandle handle1 = m_bodies.GetHandleFromSlot(pair.id1);
+		BodyHandle handle2 = m_bodies.GetHandleFromSlot(pair.id2);
+		int shapeID1 = shapeIDs[m_bodies.GetIndex(handle1)];
+		int shapeID2 = shapeIDs[m_bodies.GetIndex(handle2)];
+
+		if (shapeID1 > shapeID2) {
+			std::swap(handle1, handle2);
+			std::swap(shapeID1, shapeID2);
+		}
+		m_pairBuckets[shapeID1][shapeID2].push_back(BodyPair{ handle1, handle2 });
+	}
+
+	for (int shapeID1 = 0; shapeID1 < ShapeCount; shapeID1++)
+	{
+		for (int shapeID2 = 0; shapeID2 < ShapeCount; shapeID2++)
+		{
+			m_narrowphaseStats.candidateCounts[shapeID1][shapeID2] = m_pairBuckets[shapeID1][shapeID2].size();
+		}
+	}
+}
+
+// Keeps the pairs at the indexes given, which are in order
+static void KeepPairs(std::vector<BodyPair>& pairs, const std::vector<uint32_t>& pairIndexes)
+{
+	size_t keptCount = 0;
+	for (uint32_t pairIndex : pairIndexes)
+	{
+		pairs[keptCount++] = pairs[pairIndex];
+	}
+	pairs.resize(keptCount);
+}
+
+void PhysicsScene::FilterBatches()
+{
+	const glm::vec3* positions = m_bodies.GetPositions();
+	const glm::vec3* halfExtents = m_bodies.GetHalfExtents();
+
+	const int sphereID = static_cast<int>(Shape::ID::Sphere);
+	const int planeID = static_cast<int>(Shape::ID::Plane);
+
+	// A sphere's half extents are its radius
+	std::vector<BodyPair>& sphereSpherePairs = m_pairBuckets[sphereID][sphereID];
+	m_sphereSphereBatch.Clear();
+	for (const auto& pair : sphereSpherePairs)
+	{
+		size_t index1 = m_bodies.GetIndex(pair.handle1);
+		size_t index2 = m_bodies.GetIndex(pair.handle2);
+		m_sphereSphereBatch.Add(positions[index1], positions[index2], halfExtents[index1].x + halfExtents[index2].x);
+	}
+
+	std::vector<BodyPair>& planeSpherePairs = m_pairBuckets[planeID][sphereID];
+	m_spherePlaneBatch.Clear();
+	for (const auto& pair : planeSpherePairs)
+	{
+		const Plane* pPlane = static_cast<const Plane*>(m_bodies.GetShape(pair.handle1));
+		size_t sphereIndex = m_bodies.GetIndex(pair.handle2);
+		m_spherePlaneBatch.Add(positions[sphereIndex], halfExtents[sphereIndex].x, pPlane->GetNormal(), pPlane->GetDistance());
+	}
+
+	// Only the pairs found overlapping go on to the full test
+	m_overlappingPairs.clear();
+	m_sphereSphereBatch.FindOverlaps(m_overlappingPairs);
+	KeepPairs(sphereSpherePairs, m_overlappingPairs);
+
+	m_overlappingPairs.clear();
+	m_spherePlaneBatch.FindOverlaps(m_overlappingPairs);
+	KeepPairs(planeSpherePairs, m_overlappingPairs);
+}
+
+template<typename ShapePairTest>
+void PhysicsScene::FindContacts(const std::vector<BodyPair>& pairs)
+{
+	// Enough pairs per job to be worth handing to another thread
+	const size_t PairsPerJob = 256;
+
+	// Finding contacts only reads the bodies, the response comes after
+	auto findContacts = [&](size_t begin, size_t end, unsigned int threadIndex) {
+		std::vector<Contact>& contacts = m_threadContacts[threadIndex];
+		for (size_t i = begin; i < end; i++)
+		{
+			PhysicsObject object1(&m_bodies, pairs[i].handle1);
+			PhysicsObject object2(&m_bodies, pairs[i].handle2);
+
+			Contact contact;
+			if (ShapePairTest::FindContact(&object1, &object2, contact)) {
+				contacts.push_back(contact);
+			}
+		}
+	};
+
+	if (m_pJobSystem != nullptr) {
+		m_pJobSystem->ParallelFor(pairs.size(), PairsPerJob, findContacts);
+	}
+	else {
+		findContacts(0, pairs.size(), 0);
+	}
+}
+
+void PhysicsScene::FindContacts()
+{
+	const unsigned int threadCount = m_pJobSystem != nullptr ? m_pJobSystem->GetThreadCount() : 1;
+	m_threadContacts.resize(threadCount);
+	for (auto& contacts : m_threadContacts)
+	{
+		contacts.clear();
+	}
+
+	// One loop per bucket, with its shape pair test inlined
+	auto findBucketContacts = [this](auto shapePairType) {
+		typedef typename decltype(shapePairType)::First Shape1;
+		typedef typename decltype(shapePairType)::Second Shape2;
+
+		const auto& pairs = m_pairBuckets[static_cast<int>(Shape1::TypeID)][static_cast<int>(Shape2::TypeID)];
+		m_narrowphaseStats.testedCounts[static_cast<int>(Shape1::TypeID)][static_cast<int>(Shape2::TypeID)] = pairs.size();
+		m_profiler.GetStats().pairsTested += pairs.size();
+		FindContacts<ShapePair<Shape1, Shape2>>(pairs);
+	};
+	ForEachShapePair(CollisionShapes(), findBucketContacts);
+
+	// Merged in pair order, so the response doesn't depend on the thread count
+	m_contacts.clear();
+	for (const auto& contacts : m_threadContacts)
+	{
+		m_contacts.insert(std::end(m_contacts), std::begin(contacts), std::end(contacts));
+	}
+	std::sort(std::begin(m_contacts), std::end(m_contacts),
+		[](const Contact& contact1, const Contact& contact2) { return contact1.GetPairKey() < contact2.GetPairKey(); });
+	m_profiler.GetStats().contactsGenerated += m_contacts.size();
+}
+
+void PhysicsScene::FindPairsBruteForce()
+{
+	const BodyHandle* handles = m_bodies.GetHandles();
+	const uint8_t* isAwake = m_bodies.GetAwakeFlags();
+
+	// Each moving body against the bodies before it, static bodies never move each other
+	for (size_t i = m_bodies.GetPartitionBegin(BodyStore::MotionType::Kinematic); i < m_bodies.GetCount(); i++)
+	{
+		for (size_t j = 0; j < i; j++)
+		{
+			// Static and sleeping bodies can't move each other
+			if (!isAwake[i] && !isAwake[j]) continue;
+
+			uint32_t id1 = handles[i].index;
+			uint32_t id2 = handles[j].index;
+			m_broadphasePairs.push_back(BroadphasePair{ std::min(id1, id2), std::max(id1, id2) });
+		}
+	}
+}
+
+void PhysicsScene::FilterPairs()
+{
+	const size_t dynamicBegin = m_bodies.GetPartitionBegin(BodyStore::MotionType::Dynamic);
+
+	// Only the body indexes are looked at, before any shape is
+	auto isFiltered = [&](const BroadphasePair& pair) {
+		size_t index1 = m_bodies.GetIndex(m_bodies.GetHandleFromSlot(pair.id1));
+		size_t index2 = m_bodies.GetIndex(m_bodies.GetHandleFromSlot(pair.id2));
+
+		// A pair without a dynamic body can't respond to a collision
+		if (index1 < dynamicBegin && index2 < dynamicBegin) return true;
+		return !m_bodies.CanCollide(index1, index2);
+	};
+
+	size_t pairCount = m_broadphasePairs.size();
+	m_broadphasePairs.erase(std::remove_if(std::begin(m_broadphasePairs), std::end(m_broadphasePairs), isFiltered), std::end(m_broadphasePairs));
+	m_narrowphaseStats.filteredCount = pairCount - m_broadphasePairs.size();
+}
+
+void PhysicsScene::WakeIslands()
+{
+	m_wokenHandles.clear();
+	m_bodies.WakeIslands(m_wokenHandles);
+
+	if (m_pBroadphase == nullptr) return;
+
+	for (BodyHandle handle : m_wokenHandles)
+	{
+		m_pBroadphase->SetStatic(handle.index, false);
+	}
+}
+
+void PhysicsScene::UpdateSleeping()
+{
+	if (m_sleepVelocity <= 0) return;
+
+	const size_t bodyCount = m_bodies.GetCount();
+	const size_t dynamicBegin = m_bodies.GetPartitionBegin(BodyStore::MotionType::Dynamic);
+	const BodyHandle* handles = m_bodies.GetHandles();
+	const glm::vec3* velocities = m_bodies.GetVelocities();
+	const float* inverseMasses = m_bodies.GetInverseMasses();
+	const uint8_t* isAwake = m_bodies.GetAwakeFlags();
+	uint16_t* restFrames = m_bodies.GetRestFrames();
+
+	// Only dynamic bodies sleep
+	const float sleepVelocitySquared = m_sleepVelocity * m_sleepVelocity;
+	for (size_t i = dynamicBegin; i < bodyCount; i++)
+	{
+		if (!isAwake[i]) continue;
+
+		if (glm::dot(velocities[i], velocities[i]) >= sleepVelocitySquared) {
+			restFrames[i] = 0;
+		}
+		else if (restFrames[i] < UINT16_MAX) {
+			restFrames[i]++;
+		}
+	}
+
+	// Bodies in contact are in the same island. Static and kinematic bodies don't join islands together.
+	m_islandParents.resize(bodyCount);
+	for (uint32_t i = 0; i < bodyCount; i++)
+	{
+		m_islandParents[i] = i;
+	}
+
+	for (const Contact& contact : m_contacts)
+	{
+		if (m_bodies.GetInverseMass(contact.handle1) == 0 || m_bodies.GetInverseMass(contact.handle2) == 0) continue;
+
+		uint32_t island1 = FindIsland(m_islandParents, static_cast<uint32_t>(m_bodies.GetIndex(contact.handle1)));
+		uint32_t island2 = FindIsland(m_islandParents, static_cast<uint32_t>(m_bodies.GetIndex(contact.handle2)));
+		m_islandParents[island2] = island1;
+	}
+
+	// An island sleeps once all of its bodies have rested long enough
+	m_isIslandResting.assign(bodyCount, 1);
+	for (uint32_t i = static_cast<uint32_t>(dynamicBegin); i < bodyCount; i++)
+	{
+		if (isAwake[i] && restFrames[i] < m_sleepSteps) {
+			m_isIslandResting[FindIsland(m_islandParents, i)] = 0;
+		}
+	}
+
+	// A moving kinematic body keeps what it's touching awake
+	for (const Contact& contact : m_contacts)
+	{
+		uint32_t index1 = static_cast<uint32_t>(m_bodies.GetIndex(contact.handle1));
+		uint32_t index2 = static_cast<uint32_t>(m_bodies.GetIndex(contact.handle2));
+		if (inverseMasses[index1] == 0 && glm::dot(velocities[index1], velocities[index1]) >= sleepVelocitySquared) {
+			m_isIslandResting[FindIsland(m_islandParents, index2)] = 0;
+		}
+		if (inverseMasses[index2] == 0 && glm::dot(velocities[index2], velocities[index2]) >= sleepVelocitySquared) {
+			m_isIslandResting[FindIsland(m_islandParents, index1)] = 0;
+		}
+	}
+
+	for (uint32_t i = static_cast<uint32_t>(dynamicBegin); i < bodyCount; i++)
+	{
+		if (!isAwake[i]) continue;
+
+		uint32_t island = FindIsland(m_islandParents, i);
+		if (!m_isIslandResting[island]) continue;
+
+		// The root body's slot names the island. A slot is only reused once its body is removed,
+		//   at worst that wakes an unrelated island.
+		m_bodies.Sleep(i, handles[island].index);
+		if (m_pBroadphase != nullptr) {
+			m_pBroadphase->SetStatic(handles[i].index, true);
+		}
+	}
+}
+
+void PhysicsScene::UpdateSweptBounds()
+{
+	// Covers the whole path, so the broadphase finds everything along the way
+	for (const SweptBody& sweptBody : m_sweptBodies)
+	{
+		// Could have despawned since it moved
+		if (!m_bodies.IsValid(sweptBody.handle)) continue;
+
+		Bounds bounds = m_bodies.GetBounds(sweptBody.handle);
+		Bounds startBounds{ bounds.min - sweptBody.displacement, bounds.max - sweptBody.displacement };
+		m_pBroadphase->Update(sweptBody.handle.index, Bounds{ glm::min(bounds.min, startBounds.min), glm::max(bounds.max, startBounds.max) });
+	}
+}
+
+void PhysicsScene::SweepFastBodies()
+{
+	// Sorted by slot to look up the bodies in each pair
+	auto isSlotLess = [](const SweptBody& sweptBody, uint32_t slot) { return sweptBody.handle.index < slot; };
+	std::sort(std::begin(m_sweptBodies), std::end(m_sweptBodies),
+		[](const SweptBody& sweptBody1, const SweptBody& sweptBody2) { return sweptBody1.handle.index < sweptBody2.handle.index; });
+
+	auto findSweptBody = [&](uint32_t slot) -> SweptBody* {
+		auto it = std::lower_bound(std::begin(m_sweptBodies), std::end(m_sweptBodies), slot, isSlotLess);
+		bool isFound = it != std::end(m_sweptBodies) && it->handle.index == slot && m_bodies.IsValid(it->handle);
+		return isFound ? &*it : nullptr;
+	};
 
+	// Keep the earliest hit for each swept body
+	for (const auto& pair : m_broadphasePairs)
+	{
+		SweptBody* pSweptBody1 = findSweptBody(pair.id1);
+		SweptBody* pSweptBody2 = findSweptBody(pair.id2);
+		if (pSweptBody1 == nullptr && pSweptBody2 == nullptr) continue;
+
+		PhysicsObject object1(&m_bodies, m_bodies.GetHandleFromSlot(pair.id1));
+		PhysicsObject object2(&m_bodies, m_bodies.GetHandleFromSlot(pair.id2));
+		glm::vec3 displacement1 = pSweptBody1 != nullptr ? pSweptBody1->displacement : glm::vec3(0);
+		glm::vec3 displacement2 = pSweptBody2 != nullptr ? pSweptBody2->displacement : glm::vec3(0);
+
+		// The swept body ends up overlapping by a little, so the contact is found this step
+		const float SweepOverlap = 0.01f;
+		float timeOfImpact;
+
+		if (pSweptBody1 != nullptr) {
+			float radius = object1.GetShape<Sphere>()->GetRadius() - SweepOverlap;
+			if (Collision::SweepSphere(object1.GetPosition() - displacement1, displacement1, radius, &object2, displacement2, timeOfImpact)) {
+				pSweptBody1->timeOfImpact = std::min(pSweptBody1->timeOfImpact, timeOfImpact);
+			}
+		}
+
+		if (pSweptBody2 != nullptr) {
+			float radius = object2.GetShape<Sphere>()->GetRadius() - SweepOverlap;
+			if (Collision::SweepSphere(object2.GetPosition() - displacement2, displacement2, radius, &object1, displacement1, timeOfImpact)) {
+				pSweptBody2->timeOfImpact = std::min(pSweptBody2->timeOfImpact, timeOfImpact);
+			}
+		}
+	}
+
+	// Move each back to where it first hit. It keeps its velocity for the solver to respond to.
+	for (const SweptBody& sweptBody : m_sweptBodies)
+	{
+		if (sweptBody.timeOfImpact >= 1 || !m_bodies.IsValid(sweptBody.handle)) continue;
+
+		m_bodies.Translate(sweptBody.handle, -sweptBody.displacement * (1 - sweptBody.timeOfImpact));
+	}
 }
@@ -1,41 +1,245 @@
 #pragma once
 
+#include "AABBTreeBroadphase.h"
 #include "BasePhysicsScene.h"
+#include "BodyStore.h"
+#include "Broadphase.h"
+#include "Collision.h"
+#include "CollisionBatch.h"
+#include "ContactSolver.h"
+#include "Shapes.h"
+#include "SpatialHash.h"
+#include "TripleBuffer.h"
 
 #include <memory>
 #include <vector>
 
-class Shape;
-class PhysicsObject;
+class JobSystem;
+class ShapeDrawer;
+class SimulationRecorder;
 class RigidBody;
 
 
 class PhysicsScene : public BasePhysicsScene
 {
 public:
+	static const int DefaultMaxSubsteps = 4;
+	static constexpr float DefaultSleepVelocity = 0.2f;
+	static const uint16_t DefaultSleepSteps = 60;
+	static constexpr float DefaultSweepMotionFraction = 0.5f;
+
+	static const int ShapeCount = static_cast<int>(Shape::ID::Count);
+
+	enum class BroadphaseType { BruteForce, SweepAndPrune, SpatialHash, AABBTree };
+
+	// Pairs of each pair of shapes in the last step, indexed by shape ID with the lower ID first
+	struct NarrowphaseStats
+	{
+		size_t candidateCounts[ShapeCount][ShapeCount];	// From the broadphase
+		size_t testedCounts[ShapeCount][ShapeCount];	// Left after the batched overlap tests
+		size_t filteredCount;	// Broadphase pairs dropped without a dynamic body, or by the collision filter
+	};
+
 	PhysicsScene() : PhysicsScene(glm::vec3(0)) {}
-	PhysicsScene(glm::vec3 offset) : m_offset(offset) {}
+	PhysicsScene(glm::vec3 offset);
+
+	// BruteForce tests every pair of bodies, useful for comparing against the others.
+	void SetBroadphase(BroadphaseType type);
+	BroadphaseType GetBroadphase() const { return m_broadphaseType; }
+
+	// Best set to about the size of the most common body
+	void SetSpatialHashCellSize(float cellSize);
+	// Null unless the spatial hash broadphase is in use
+	const SpatialHash::Stats* GetSpatialHashStats() const;
+
+	// Sphere-sphere and sphere-plane pairs from the broadphase are tested in batches with
+	//   SIMD before their full test. On by default.
+	void SetBatchedNarrowphase(bool isBatched) { m_isNarrowphaseBatched = isBatched; }
+	const NarrowphaseStats& GetNarrowphaseStats() const { return m_narrowphaseStats; }
+
+	// Collision pairs are split across the pool's threads. The scene doesn't own the pool.
+	// Null, the default, runs everything on the calling thread.
+	void SetJobSystem(JobSystem* pJobSystem) { m_pJobSystem = pJobSystem; }
+
+	// Every step is recorded while the recorder is recording. The scene doesn't own it.
+	// Null, the default, records nothing.
+	void SetRecorder(SimulationRecorder* pRecorder) { m_pRecorder = pRecorder; }
+
+	// Draw draws each body's shape through the drawer. The scene doesn't own it.
+	// Null, the default, draws nothing, for running without a renderer.
+	// The bodies are drawn as the last Update left them, copied out at its end, so Draw can
+	//   be called while the scene steps on another thread, see SimulationThread.
+	void SetShapeDrawer(ShapeDrawer* pShapeDrawer) { m_pShapeDrawer = pShapeDrawer; }
+
+	// Steps by a fixed amount of time, as many times as fit in the time passed to Update.
+	// The time left over carries to the next Update and Draw interpolates across it.
+	// At most maxSubsteps are run per Update, the rest of the time is dropped so a slow
+	//   frame doesn't cause more steps and slower frames after it.
+	// A timestep of zero, the default, steps once per Update by the frame's time.
+	void SetFixedTimestep(float timestep, int maxSubsteps = DefaultMaxSubsteps);
+	float GetFixedTimestep() const { return m_fixedTimestep; }
+
+	// Spheres that move further than the fraction of their radius in a step are swept along
+	//   their path, and stopped where they first hit something, so they can't pass through it.
+	// Off when the fraction is zero.
+	void SetContinuousCollision(float motionFraction) { m_sweepMotionFraction = motionFraction; }
+
+	// More iterations resolve stacks and piles better, the solver stops early once it has
+	//   converged. Warm starting begins each contact from its impulse in the last step.
+	void SetSolverIterations(int iterationCount) { m_contactSolver.SetIterations(iterationCount); }
+	void SetWarmStarting(bool isWarmStarting) { m_contactSolver.SetWarmStarting(isWarmStarting); }
+	// From the last step, includes the solver residual of each iteration
+	const ContactSolver::Stats& GetSolverStats() const { return m_contactSolver.GetStats(); }
+
+	// Bodies that stay slower than the velocity for the number of steps are put to sleep,
+	//   once every body they're touching is too. Sleeping bodies aren't moved or tested
+	//   against each other, they wake when hit or pushed.
+	// A velocity of zero turns sleeping off.
+	void SetSleepThreshold(float velocity, uint16_t stepCount = DefaultSleepSteps);
+	size_t GetAwakeBodyCount() const;
+
+	// Shapes are made in per-scene pools that only grow and reuse the slots of removed bodies.
+	// Once bodies are removed as fast as they're added, the slab allocation count stops growing.
+	PoolStats GetShapePoolStats() const { return m_bodies.GetShapePoolStats(); }
 
     void Update(float deltaTime) override;
     void Draw() override;
 
-	void AddPlaneStatic(glm::vec3 normal, float distance) override;
-	void AddSphereStatic(glm::vec3 position, float radius) override;
-	void AddAABBStatic(glm::vec3 position, glm::vec3 extents) override;
+	BodyHandle AddPlaneStatic(glm::vec3 normal, float distance) override;
+	BodyHandle AddSphereStatic(glm::vec3 position, float radius) override;
+	BodyHandle AddAABBStatic(glm::vec3 position, glm::vec3 extents) override;
+
+	BodyHandle AddPlaneDynamic(glm::vec3 normal, float distance, float mass, glm::vec3 velocity) override;
+	BodyHandle AddSphereDynamic(glm::vec3 position, float radius, float mass, glm::vec3 velocity) override;
+	BodyHandle AddAABBDynamic(glm::vec3 position, glm::vec3 extents, float mass, glm::vec3 velocity) override;
 
-	void AddPlaneDynamic(glm::vec3 normal, float distance, float mass, glm::vec3 velocity) override;
-	void AddSphereDynamic(glm::vec3 position, float radius, float mass, glm::vec3 velocity) override;
-	void AddAABBDynamic(glm::vec3 position, glm::vec3 extents, float mass, glm::vec3 velocity) override;
+	void AddSpheresDynamic(size_t count, const glm::vec3* pPositions, const float* pRadii, const float* pMasses, const glm::vec3* pVelocities, BodyHandle* pHandles = nullptr) override;
+	void AddAABBsDynamic(size_t count, const glm::vec3* pPositions, const glm::vec3* pExtents, const float* pMasses, const glm::vec3* pVelocities, BodyHandle* pHandles = nullptr) override;
+
+	// Kinematic bodies move at their velocity and push dynamic bodies out of the way, nothing
+	//   pushes them back. Collisions between static and kinematic bodies aren't tested.
+	BodyHandle AddSphereKinematic(glm::vec3 position, float radius, glm::vec3 velocity);
+	BodyHandle AddAABBKinematic(glm::vec3 position, glm::vec3 extents, glm::vec3 velocity);
+	void SetKinematicVelocity(BodyHandle handle, glm::vec3 velocity) { m_bodies.SetKinematicVelocity(handle, velocity); }
+
+	// Bodies are on one or more of 32 layers and only collide with bodies on a layer in their
+	//   mask, both ways round. Pairs are dropped before any shape is looked at.
+	// Every body is on the first layer and collides with every layer by default.
+	void SetCollisionFilter(BodyHandle handle, uint32_t layers, uint32_t mask) { m_bodies.SetCollisionFilter(handle, layers, mask); }
+
+	void Remove(BodyHandle handle) override;
+	size_t GetBodyCount() const override;
+
+	// Answered with an AABB tree of every body, whichever broadphase is in use. It's only
+	//   built on the first query, and brought up to date with the first query after each step.
+	// RaycastBatch splits the rays across the job system's threads.
+	bool Raycast(glm::vec3 origin, glm::vec3 direction, float maxDistance, QueryHit& hit, uint32_t layerMask = AllQueryLayers) override;
+	size_t OverlapSphere(glm::vec3 center, float radius, BodyHandle* pHandles, size_t maxCount, uint32_t layerMask = AllQueryLayers) override;
+	bool SweepBox(glm::vec3 center, glm::vec3 extents, glm::vec3 direction, float maxDistance, QueryHit& hit, uint32_t layerMask = AllQueryLayers) override;
+	void RaycastBatch(const RaycastQuery* pQueries, size_t count, QueryHit* pHits) override;
+
+	// Snapshots hold the state of every body and the solver's cached impulses, so stepping on
+	//   from a restored snapshot gives the same results as stepping on from where it was saved.
+	// Handles from when it was saved are valid again after a restore. Settings, like the
+	//   broadphase or sleep threshold, aren't saved and are kept from the restoring scene.
+	// Positions include the scene's offset, restore into a scene with the same one.
+	void SaveSnapshot(std::vector<uint8_t>& data) const;
+	bool SaveSnapshot(const char* pPath) const;
+	// Returns false and leaves the scene unchanged if the snapshot is broken or from another
+	//   version. Files are memory mapped and read in place, only the pages read are loaded.
+	bool RestoreSnapshot(const void* pData, size_t size);
+	bool RestoreSnapshot(const char* pPath);
 
 private:
-	void AddPlane(glm::vec3 normal, float distance, RigidBody* pRigidBody=nullptr);
-	void AddSphere(glm::vec3 position, float radius, RigidBody* pRigidBody=nullptr);
-	void AddAABB(glm::vec3 position, glm::vec3 extents, RigidBody* pRigidBody=nullptr);
+	BodyHandle AddPlane(glm::vec3 normal, float distance, const RigidBody* pRigidBody=nullptr);
+	BodyHandle AddSphere(glm::vec3 position, float radius, const RigidBody* pRigidBody=nullptr);
+	BodyHandle AddAABB(glm::vec3 position, glm::vec3 extents, const RigidBody* pRigidBody=nullptr);
 
-	void AddObject(std::shared_ptr<PhysicsObject> pPhysicsObject);
+	BodyHandle AddBody(glm::vec3 position, Shape* pShape, const RigidBody* pRigidBody);
+	void AddBodiesDynamic(size_t count, const glm::vec3* pPositions, Shape* const* ppShapes, const float* pMasses, const glm::vec3* pVelocities, BodyHandle* pHandles);
+	void Step(float deltaTime);
+	void PublishDrawState();
+	void WakeIslands();
+	void UpdateSleeping();
+	void Integrate(float deltaTime);
+	void Despawn(float deltaTime);
     void CheckCollisions();
+	void UpdateSweptBounds();
+	void SweepFastBodies();
+	void FindPairsBruteForce();
+	void FilterPairs();
+	void BucketPairs();
+	void FilterBatches();
+	void FindContacts();
+	template<typename ShapePairTest>
+	void FindContacts(const std::vector<BodyPair>& pairs);
+	void AddToBroadphase(BodyHandle handle);
+	void AddToQueryTree(BodyHandle handle);
+	const AABBTreeBroadphase& UpdateQueryTree();
+	// Against the query tree as it is, so any number can be cast at once
+	bool CastBox(const AABBTreeBroadphase& queryTree, glm::vec3 origin, glm::vec3 extents, glm::vec3 direction, float maxDistance, uint32_t layerMask, QueryHit& hit) const;
 
 	glm::vec3 m_offset;
+	ShapeDrawer* m_pShapeDrawer = nullptr;
+
+	// A body as Draw needs it, so drawing doesn't touch the bodies
+	struct DrawnBody
+	{
+		Shape::ID shapeID;
+		glm::vec3 position;	// Interpolated
+		glm::vec3 size;		// The sphere's radius in x, the AABB's extents or the plane's normal
+		float distance;		// The plane's
+	};
+	// Written at the end of Update, read by Draw
+	TripleBuffer<std::vector<DrawnBody>> m_drawStates;
+
     glm::vec3 m_gravity = DefaultGravity;
-    std::vector< std::shared_ptr<PhysicsObject> > m_pPhysicsObjects;
+	BodyStore m_bodies;
+
+	float m_fixedTimestep = 0;
+	int m_maxSubsteps = DefaultMaxSubsteps;
+	float m_accumulatedTime = 0;
+
+	// Spheres moving fast enough to need sweeping this step
+	struct SweptBody
+	{
+		BodyHandle handle;
+		glm::vec3 displacement;
+		float timeOfImpact;
+	};
+	float m_sweepMotionFraction = DefaultSweepMotionFraction;
+	std::vector<SweptBody> m_sweptBodies;
+	std::vector<std::vector<SweptBody>> m_sweptBodyChunks; // One per integration job
+	std::vector<glm::vec3> m_displacements; // From the last integration, indexed like the bodies
+
+	float m_sleepVelocity = DefaultSleepVelocity;
+	uint16_t m_sleepSteps = DefaultSleepSteps;
+	std::vector<BodyHandle> m_wokenHandles;
+	std::vector<uint32_t> m_islandParents;
+	std::vector<uint8_t> m_isIslandResting;
+
+	BroadphaseType m_broadphaseType;
+	float m_spatialHashCellSize = SpatialHash::DefaultCellSize;
+	std::unique_ptr<Broadphase> m_pBroadphase;
+	std::vector<BroadphasePair> m_broadphasePairs;
+
+	// Scene queries don't depend on the broadphase, they have a tree of their own
+	std::unique_ptr<AABBTreeBroadphase> m_pQueryTree;
+	bool m_isQueryTreeStale = false;
+
+	// Broadphase pairs by the shapes in them, each is tested in its own loop with the shapes
+	//   known at compile time. The body with the lower shape ID is first.
+	std::vector<BodyPair> m_pairBuckets[ShapeCount][ShapeCount];
+	NarrowphaseStats m_narrowphaseStats = {};
+
+	bool m_isNarrowphaseBatched = true;
+	SphereSphereBatch m_sphereSphereBatch;
+	SpherePlaneBatch m_spherePlaneBatch;
+	std::vector<uint32_t> m_overlappingPairs;
+
+	JobSystem* m_pJobSystem = nullptr;
+	SimulationRecorder* m_pRecorder = nullptr;
+	std::vector<std::vector<Contact>> m_threadContacts; // One buffer per thread, no locking
+	std::vector<Contact> m_contacts;
+	ContactSolver m_contactSolver;
 };
@@ -0,0 +1,75 @@
+#include "Profiler.h"
+
+#include <cstdio>
+
+
+static const char* StepPhaseNames[] = {
+	"Wake", "Integrate", "Despawn", "Broadphase", "Continuous", "Narrowphase", "Solver", "Sleeping", "Simulate"
+};
+static_assert(sizeof(StepPhaseNames) / sizeof(StepPhaseNames[0]) == static_cast<int>(StepPhase::Count), "Every phase needs a name");
+
+const char* GetStepPhaseName(StepPhase phase)
+{
+	return StepPhaseNames[static_cast<int>(phase)];
+}
+
+
+void Profiler::StartTrace()
+{
+	m_traceEvents.clear();
+	m_traceStartTime = Clock::now();
+	m_isTracing = true;
+}
+
+bool Profiler::WriteTrace(const char* pPath)
+{
+	m_isTracing = false;
+
+	FILE* pFile = fopen(pPath, "w");
+	if (pFile == nullptr) return false;
+
+	// Complete events, with times in microseconds since the trace started
+	auto toMicroseconds = [this](Clock::time_point time) {
+		return std::chrono::duration<double, std::micro>(time - m_traceStartTime).count();
+	};
+
+	fprintf(pFile, "{\"traceEvents\":[\n");
+	for (size_t i = 0; i < m_traceEvents.size(); i++)
+	{
+		const TraceEvent& event = m_traceEvents[i];
+		fprintf(pFile, "{\"name\":\"%s\",\"cat\":\"physics\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":0,\"tid\":0}%s\n",
+			event.pName, toMicroseconds(event.startTime), toMicroseconds(event.endTime) - toMicroseconds(event.startTime),
+			i + 1 < m_traceEvents.size() ? "," : "");
+	}
+	fprintf(pFile, "]}\n");
+
+	m_traceEvents.clear();
+	return fclose(pFile) == 0;
+}
+
+void Profiler::BeginFrame()
+{
+	m_stats = FrameStats{};
+	if (IsEnabled()) {
+		m_frameStartTime = Clock::now();
+	}
+}
+
+void Profiler::EndFrame()
+{
+	if (!IsEnabled()) return;
+
+	Clock::time_point endTime = Clock::now();
+	m_stats.totalTime = std::chrono::duration<double, std::milli>(endTime - m_frameStartTime).count();
+	if (m_isTracing) {
+		m_traceEvents.push_back(TraceEvent{ "Update", m_frameStartTime, endTime });
+	}
+}
+
+void Profiler::AddPhaseTime(StepPhase phase, Clock::time_point startTime, Clock::time_point endTime)
+{
+	m_stats.phaseTimes[static_cast<int>(phase)] += std::chrono::duration<double, std::milli>(endTime - startTime).count();
+	if (m_isTracing) {
+		m_traceEvents.push_back(TraceEvent{ GetStepPhaseName(phase), startTime, endTime });
+	}
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+// The phases of a step, in the order they run
+enum class StepPhase
+{
+	Wake,			// Waking islands of bodies pushed since the last step
+	Integrate,		// Damping, gravity and moving the bodies
+	Despawn,
+	Broadphase,
+	Continuous,		// Sweeping fast bodies
+	Narrowphase,
+	Solver,
+	Sleeping,
+	Simulate,		// For scenes that step as a whole, like PhysX
+	Count
+};
+
+const char* GetStepPhaseName(StepPhase phase);
+
+
+// What happened in one frame, summed over all of the frame's steps
+struct FrameStats
+{
+	// Milliseconds, only timed while profiling
+	double phaseTimes[static_cast<int>(StepPhase::Count)];
+	double totalTime;
+
+	int stepCount;
+	size_t bodiesIntegrated;
+	size_t pairsTested;			// By the narrowphase
+	size_t contactsGenerated;
+	size_t sleepingBodies;		// At the end of the frame
+
+	double GetPhaseTime(StepPhase phase) const { return phaseTimes[static_cast<int>(phase)]; }
+};
+
+
+// Collects the stats of each frame for a scene.
+// Counters are always kept. Phases are only timed while profiling is on, otherwise a
+//   ScopedPhaseTimer is a branch and nothing else.
+// While tracing, every timed phase is also kept as an event for the Chrome trace viewer,
+//   chrome://tracing, until the trace is written.
+class Profiler
+{
+public:
+	typedef std::chrono::high_resolution_clock Clock;
+
+	void SetEnabled(bool isEnabled) { m_isEnabled = isEnabled; }
+	bool IsEnabled() const { return m_isEnabled || m_isTracing; }
+
+	// Tracing times the phases even if profiling is off
+	void StartTrace();
+	// Writes the events traced so far as trace event JSON and stops tracing
+	bool WriteTrace(const char* pPath);
+
+	void BeginFrame();
+	void EndFrame();
+	void AddPhaseTime(StepPhase phase, Clock::time_point startTime, Clock::time_point endTime);
+
+	FrameStats& GetStats() { return m_stats; }
+	const FrameStats& GetStats() const { return m_stats; }
+
+private:
+	struct TraceEvent
+	{
+		const char* pName;
+		Clock::time_point startTime;
+		Clock::time_point endTime;
+	};
+
+	bool m_isEnabled = false;
+	bool m_isTracing = false;
+	FrameStats m_stats = {};
+	Clock::time_point m_frameStartTime;
+	Clock::time_point m_traceStartTime;
+	std::vector<TraceEvent> m_traceEvents;
+};
+
+
+// Adds the time until it goes out of scope to a phase
+class ScopedPhaseTimer
+{
+public:
+	ScopedPhaseTimer(Profiler& profiler, StepPhase phase) :
+		m_pProfiler(profiler.IsEnabled() ? &profiler : nullptr),
+		m_phase(phase)
+	{
+		if (m_pProfiler != nullptr) m_startTime = Profiler::Clock::now();
+	}
+
+	~ScopedPhaseTimer()
+	{
+		if (m_pProfiler != nullptr) m_pProfiler->AddPhaseTime(m_phase, m_startTime, Profiler::Clock::now());
+	}
+
+	ScopedPhaseTimer(const ScopedPhaseTimer&) = delete;
+	ScopedPhaseTimer& operator=(const ScopedPhaseTimer&) = delete;
+
+private:
+	Profiler* m_pProfiler;
+	StepPhase m_phase;
+	Profiler::Clock::time_point m_startTime;
+};
@@ -0,0 +1,128 @@
+#include "RecordingReader.h"
+
+#include "Snapshot.h"
+
+#include <algorithm>
+#include <cstring>
+
+
+bool RecordingReader::Open(const char* pPath)
+{
+	Close();
+
+	if (!m_file.Open(pPath) || m_file.GetSize() < sizeof(RecordingHeader)) {
+		Close();
+		return false;
+	}
+
+	memcpy(&m_header, m_file.GetData(), sizeof(m_header));
+	if (m_header.magic != RecordingHeader::Magic || m_header.version != RecordingHeader::Version) {
+		Close();
+		return false;
+	}
+
+	// Hops from header to header, payloads aren't touched until they're decoded
+	const uint8_t* pData = static_cast<const uint8_t*>(m_file.GetData());
+	const size_t size = m_file.GetSize();
+	size_t offset = sizeof(RecordingHeader);
+	while (size - offset >= sizeof(RecordingFrameHeader))
+	{
+		RecordingFrameHeader header;
+		memcpy(&header, pData + offset, sizeof(header));
+		if (header.size > size - offset - sizeof(header)) break;
+
+		if (header.type == RecordingFrameHeader::Keyframe) {
+			m_keyframeIndexes.push_back(m_frameOffsets.size());
+		}
+		m_frameOffsets.push_back(offset);
+		offset += sizeof(header) + static_cast<size_t>(header.size);
+	}
+
+	return true;
+}
+
+void RecordingReader::Close()
+{
+	m_file.Close();
+	m_header = RecordingHeader{};
+	m_frameOffsets.clear();
+	m_keyframeIndexes.clear();
+	m_frameIndex = NoFrame;
+	m_step = 0;
+	m_handles.clear();
+	m_positions.clear();
+	m_velocities.clear();
+}
+
+bool RecordingReader::IsKeyframe() const
+{
+	return m_frameIndex != NoFrame && GetFrameHeader(m_frameIndex).type == RecordingFrameHeader::Keyframe;
+}
+
+const RecordingFrameHeader& RecordingReader::GetFrameHeader(size_t frameIndex) const
+{
+	// The offsets are 16 byte aligned, from the start of a mapping
+	return *reinterpret_cast<const RecordingFrameHeader*>(static_cast<const uint8_t*>(m_file.GetData()) + m_frameOffsets[frameIndex]);
+}
+
+bool RecordingReader::SeekFrame(size_t frameIndex)
+{
+	if (frameIndex >= m_frameOffsets.size()) return false;
+	if (frameIndex == m_frameIndex) return true;
+
+	auto keyframe = std::upper_bound(std::begin(m_keyframeIndexes), std::end(m_keyframeIndexes), frameIndex);
+	if (keyframe == std::begin(m_keyframeIndexes)) return false;
+	size_t startIndex = *(keyframe - 1);
+
+	// Carry on from the current frame rather than go back to the keyframe
+	if (m_frameIndex != NoFrame && m_frameIndex >= startIndex && m_frameIndex < frameIndex) {
+		startIndex = m_frameIndex + 1;
+	}
+
+	for (size_t i = startIndex; i <= frameIndex; i++)
+	{
+		if (!DecodeFrame(i)) {
+			m_frameIndex = NoFrame;
+			return false;
+		}
+	}
+	return true;
+}
+
+bool RecordingReader::DecodeFrame(size_t frameIndex)
+{
+	const RecordingFrameHeader& header = GetFrameHeader(frameIndex);
+	SnapshotReader reader(&header + 1, static_cast<size_t>(header.size));
+	const size_t bodyCount = header.bodyCount;
+
+	if (header.type == RecordingFrameHeader::Keyframe) {
+		if (!reader.ReadArray(m_handles, bodyCount) ||
+			!reader.ReadArray(m_positions, bodyCount) ||
+			!reader.ReadArray(m_velocities, bodyCount)) {
+			return false;
+		}
+	}
+	else {
+		// Deltas are from the frame before, which has to have been decoded
+		if (m_frameIndex != frameIndex - 1 || bodyCount != m_handles.size()) return false;
+
+		size_t deltaCount;
+		const int16_t* positionDeltas = reader.ReadArray<int16_t>(deltaCount, bodyCount * 3);
+		const int16_t* velocityDeltas = reader.ReadArray<int16_t>(deltaCount, bodyCount * 3);
+		if (positionDeltas == nullptr || velocityDeltas == nullptr) return false;
+
+		// The same sums as the recorder, so the values match it exactly
+		for (size_t i = 0; i < bodyCount; i++)
+		{
+			for (int axis = 0; axis < 3; axis++)
+			{
+				m_positions[i][axis] += static_cast<float>(positionDeltas[i * 3 + axis]) * m_header.positionPrecision;
+				m_velocities[i][axis] += static_cast<float>(velocityDeltas[i * 3 + axis]) * m_header.velocityPrecision;
+			}
+		}
+	}
+
+	m_frameIndex = frameIndex;
+	m_step = header.step;
+	return true;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "HandleTable.h"
+#include "MappedFile.h"
+#include "SimulationRecorder.h"
+
+#include <cstdint>
+#include <glm/vec3.hpp>
+#include <vector>
+
+// Plays back a recording made by SimulationRecorder.
+// The file is memory mapped and its frames found when it's opened. Seeking decodes forward
+//   from the nearest keyframe before the frame, or from the current frame if that's closer,
+//   so stepping through in order decodes one frame at a time.
+// A recording cut short, by a crash say, is read up to its last whole frame.
+class RecordingReader
+{
+public:
+	// Returns false if the file can't be read or isn't a recording of this version
+	bool Open(const char* pPath);
+	void Close();
+
+	size_t GetFrameCount() const { return m_frameOffsets.size(); }
+	// Returns false if the frame is out of range or broken
+	bool SeekFrame(size_t frameIndex);
+
+	// The frame seeked to. Its step counts from the first recorded step, steps dropped by
+	//   the recorder leave a gap.
+	size_t GetFrameIndex() const { return m_frameIndex; }
+	uint64_t GetStep() const { return m_step; }
+	bool IsKeyframe() const;
+
+	size_t GetBodyCount() const { return m_handles.size(); }
+	const BodyHandle* GetHandles() const { return m_handles.data(); }
+	const glm::vec3* GetPositions() const { return m_positions.data(); }
+	const glm::vec3* GetVelocities() const { return m_velocities.data(); }
+
+private:
+	static const size_t NoFrame = SIZE_MAX;
+
+	const RecordingFrameHeader& GetFrameHeader(size_t frameIndex) const;
+	bool DecodeFrame(size_t frameIndex);
+
+	MappedFile m_file;
+	RecordingHeader m_header = {};
+	std::vector<size_t> m_frameOffsets;
+	std::vector<size_t> m_keyframeIndexes; // Into the frames, in order
+
+	size_t m_frameIndex = NoFrame;
+	uint64_t m_step = 0;
+	std::vector<BodyHandle> m_handles;
+	std::vector<glm::vec3> m_positions;
+	std::vector<glm::vec3> m_velocities;
+};
@@ -1,7 +1,9 @@
 #pragma once
 
-#include <glm\vec3.hpp>
+#include <glm/vec3.hpp>
 
+// The mass and starting velocity of a dynamic body.
+// Once added to a scene the body's state lives in the scene's BodyStore.
 class RigidBody
 {
 public:
@@ -14,20 +16,10 @@ public:
     glm::vec3 GetVelocity() const { return m_velocity;  }
 	glm::vec3 GetMomentum() const { return GetMass() * GetVelocity(); }
 
-    glm::vec3 CalculatePositionDelta(float deltaTime, glm::vec3 gravity);
-
-	void Stop() { m_velocity = glm::vec3(0); }
-	void AddVelocity(glm::vec3 velocity);
-	void AddMomentum(glm::vec3 momentum);
-    void AddForce(glm::vec3 force);
+	// Applies the accumulated force and gravity to the velocity, returns how far the body moved.
+	static glm::vec3 Integrate(glm::vec3& velocity, glm::vec3 force, float inverseMass, float deltaTime, glm::vec3 gravity);
 
 private:
-    // Constants
     float m_mass;
-
-    // Derived data
     glm::vec3 m_velocity;
-
-    // Accumulated data
-    glm::vec3 m_force;
-};
\ No newline at end of file
+};
@@ -0,0 +1,242 @@
+#include "ScalingBenchmark.h"
+
+#include "JobSystem.h"
+#include "SceneScheduler.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+// Bodies are dropped in a walled box, so nearly all of them end up in contact
+static void CreatePile(PhysicsScene& scene, size_t bodyCount)
+{
+	const float Spacing = 1.5f;
+	const int side = static_cast<int>(std::ceil(std::cbrt(static_cast<double>(bodyCount))));
+	const float halfSize = side * Spacing / 2;
+	const float wallHeight = side * Spacing;
+
+	scene.AddPlaneStatic(glm::vec3(0, 1, 0), 0);
+	scene.AddAABBStatic(glm::vec3(0, wallHeight, halfSize + 1), glm::vec3(halfSize + 2, wallHeight, 1));
+	scene.AddAABBStatic(glm::vec3(0, wallHeight, -halfSize - 1), glm::vec3(halfSize + 2, wallHeight, 1));
+	scene.AddAABBStatic(glm::vec3(halfSize + 1, wallHeight, 0), glm::vec3(1, wallHeight, halfSize));
+	scene.AddAABBStatic(glm::vec3(-halfSize - 1, wallHeight, 0), glm::vec3(1, wallHeight, halfSize));
+
+	std::default_random_engine generator;
+	std::uniform_real_distribution<float> velocityDistribution(-1, 1);
+
+	// Every other body is a box, they're added in two batches
+	std::vector<glm::vec3> positions[2];
+	std::vector<glm::vec3> velocities[2];
+	for (size_t i = 0; i < bodyCount; i++)
+	{
+		int x = static_cast<int>(i % side);
+		int z = static_cast<int>((i / side) % side);
+		int y = static_cast<int>(i / (side * side));
+		positions[i % 2].push_back(glm::vec3(-halfSize + (x + 0.5f) * Spacing, 1 + y * Spacing, -halfSize + (z + 0.5f) * Spacing));
+		velocities[i % 2].push_back(glm::vec3(velocityDistribution(generator), 0, velocityDistribution(generator)));
+	}
+
+	std::vector<float> radii(positions[0].size(), 0.5f);
+	std::vector<float> masses(positions[0].size(), 1);
+	scene.AddSpheresDynamic(positions[0].size(), positions[0].data(), radii.data(), masses.data(), velocities[0].data());
+
+	std::vector<glm::vec3> extents(positions[1].size(), glm::vec3(0.5f));
+	masses.assign(positions[1].size(), 1);
+	scene.AddAABBsDynamic(positions[1].size(), positions[1].data(), extents.data(), masses.data(), velocities[1].data());
+}
+
+// Spheres roll across a wide floor between static boxes, most of them aren't touching
+//   anything, like an open world with a large static environment
+static void CreateScatter(PhysicsScene& scene, size_t bodyCount)
+{
+	const float Spacing = 4;
+	const int side = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(bodyCount))));
+	const float halfSize = side * Spacing / 2;
+
+	scene.AddPlaneStatic(glm::vec3(0, 1, 0), 0);
+
+	std::default_random_engine generator;
+	std::uniform_real_distribution<float> velocityDistribution(-5, 5);
+
+	// One static box per ten bodies
+	for (size_t i = 0; i < bodyCount; i += 10)
+	{
+		int x = static_cast<int>(i % side);
+		int z = static_cast<int>(i / side);
+		scene.AddAABBStatic(glm::vec3(-halfSize + x * Spacing + Spacing / 2, 1, -halfSize + z * Spacing), glm::vec3(0.5f, 1, 0.5f));
+	}
+
+	std::vector<glm::vec3> positions(bodyCount);
+	std::vector<glm::vec3> velocities(bodyCount);
+	for (size_t i = 0; i < bodyCount; i++)
+	{
+		int x = static_cast<int>(i % side);
+		int z = static_cast<int>(i / side);
+		positions[i] = glm::vec3(-halfSize + x * Spacing, 0.5f, -halfSize + z * Spacing);
+		velocities[i] = glm::vec3(velocityDistribution(generator), 0, velocityDistribution(generator));
+	}
+
+	std::vector<float> radii(bodyCount, 0.5f);
+	std::vector<float> masses(bodyCount, 1);
+	scene.AddSpheresDynamic(bodyCount, positions.data(), radii.data(), masses.data(), velocities.data());
+}
+
+struct Scenario
+{
+	const char* pName;
+	void(*create)(PhysicsScene& scene, size_t bodyCount);
+};
+
+static const Scenario Scenarios[] = {
+	{ "pile", CreatePile },
+	{ "scatter", CreateScatter },
+};
+
+static const char* GetBroadphaseName(PhysicsScene::BroadphaseType broadphase)
+{
+	switch (broadphase)
+	{
+	case PhysicsScene::BroadphaseType::BruteForce: return "brute";
+	case PhysicsScene::BroadphaseType::SweepAndPrune: return "sap";
+	case PhysicsScene::BroadphaseType::SpatialHash: return "hash";
+	case PhysicsScene::BroadphaseType::AABBTree: return "tree";
+	}
+	return "";
+}
+
+// Simulate is only timed by scenes that step as a whole, like PhysX, never by PhysicsScene.
+// It's left out rather than reported as zero.
+static bool IsPhaseReported(int phase)
+{
+	return phase != static_cast<int>(StepPhase::Simulate);
+}
+
+static void RunScenario(const Scenario& scenario, size_t bodyCount, unsigned int threadCount, const ScalingBenchmarkSettings& settings, FILE* pOutput)
+{
+	// Every scene is the same and shares the pool, the scheduler steps them alongside each other
+	JobSystem jobSystem(threadCount);
+	SceneScheduler scheduler(jobSystem);
+	std::vector<std::unique_ptr<PhysicsScene>> scenes;
+	for (int i = 0; i < settings.sceneCount; i++)
+	{
+		auto pScene = std::make_unique<PhysicsScene>();
+		pScene->SetBroadphase(settings.broadphase);
+		pScene->SetJobSystem(&jobSystem);
+		scenario.create(*pScene, bodyCount);
+		scheduler.AddScene(pScene.get());
+		scenes.push_back(std::move(pScene));
+	}
+
+	const float Timestep = 1 / 60.0f;
+	for (int i = 0; i < settings.warmupStepCount; i++)
+	{
+		scheduler.Update(Timestep);
+	}
+
+	for (auto& pScene : scenes)
+	{
+		pScene->SetProfiling(true);
+	}
+	// Only the first scene is traced
+	if (settings.pTracePath != nullptr) {
+		scenes[0]->StartTrace();
+	}
+
+	const int PhaseCount = static_cast<int>(StepPhase::Count);
+	double phaseTimes[PhaseCount] = {};
+	double totalTime = 0;
+	double updateTime = 0;
+	double contactCount = 0;
+	for (int i = 0; i < settings.stepCount; i++)
+	{
+		scheduler.Update(Timestep);
+		updateTime += scheduler.GetUpdateTime();
+
+		for (auto& pScene : scenes)
+		{
+			const FrameStats& stats = pScene->GetFrameStats();
+			for (int phase = 0; phase < PhaseCount; phase++)
+			{
+				phaseTimes[phase] += stats.phaseTimes[phase];
+			}
+			totalTime += stats.totalTime;
+			contactCount += stats.contactsGenerated;
+		}
+	}
+
+	// Each run overwrites the last run's trace
+	if (settings.pTracePath != nullptr && !scenes[0]->StopTrace(settings.pTracePath)) {
+		fprintf(stderr, "Couldn't write %s\n", settings.pTracePath);
+	}
+
+	size_t awakeCount = 0;
+	for (auto& pScene : scenes)
+	{
+		awakeCount += pScene->GetAwakeBodyCount();
+	}
+
+	// Per scene, except for the time the scenes took together
+	const double stepCount = std::max(settings.stepCount, 1);
+	const double sceneSteps = stepCount * settings.sceneCount;
+	fprintf(pOutput, "%s,%s,%zu,%u,%d,%d", scenario.pName, GetBroadphaseName(settings.broadphase), bodyCount, threadCount, settings.sceneCount, settings.stepCount);
+	for (int phase = 0; phase < PhaseCount; phase++)
+	{
+		if (IsPhaseReported(phase)) fprintf(pOutput, ",%.4f", phaseTimes[phase] / sceneSteps);
+	}
+	fprintf(pOutput, ",%.4f,%.4f,%.0f,%zu\n", totalTime / sceneSteps, updateTime / stepCount, contactCount / sceneSteps, awakeCount / settings.sceneCount);
+	fflush(pOutput);
+}
+
+bool RunScalingBenchmark(const ScalingBenchmarkSettings& settings, FILE* pOutput)
+{
+	unsigned int maxThreadCount = settings.maxThreadCount;
+	if (maxThreadCount == 0) {
+		maxThreadCount = std::max(std::thread::hardware_concurrency(), 1u);
+	}
+
+	// 1, 2, 4... and the most threads, even if it isn't a power of two
+	std::vector<unsigned int> threadCounts;
+	for (unsigned int threadCount = 1; threadCount < maxThreadCount; threadCount *= 2)
+	{
+		threadCounts.push_back(threadCount);
+	}
+	threadCounts.push_back(maxThreadCount);
+
+	auto isRun = [&](const Scenario& scenario) { return settings.pScenario == nullptr || strcmp(settings.pScenario, scenario.pName) == 0; };
+	if (std::none_of(std::begin(Scenarios), std::end(Scenarios), isRun)) return false;
+
+	// A column for each phase, named after it
+	fprintf(pOutput, "scenario,broadphase,bodies,threads,scenes,steps");
+	for (int phase = 0; phase < static_cast<int>(StepPhase::Count); phase++)
+	{
+		if (!IsPhaseReported(phase)) continue;
+
+		std::string name = GetStepPhaseName(static_cast<StepPhase>(phase));
+		std::transform(std::begin(name), std::end(name), std::begin(name), [](char c) { return static_cast<char>(tolower(c)); });
+		fprintf(pOutput, ",%s_ms", name.c_str());
+	}
+	fprintf(pOutput, ",step_ms,all_scenes_ms,contacts,awake_bodies\n");
+
+	for (const Scenario& scenario : Scenarios)
+	{
+		if (!isRun(scenario)) continue;
+
+		for (size_t bodyCount = settings.minBodyCount; bodyCount <= settings.maxBodyCount; bodyCount *= 10)
+		{
+			for (unsigned int threadCount : threadCounts)
+			{
+				fprintf(stderr, "%s, %zu bodies, %u threads, %d scenes\n", scenario.pName, bodyCount, threadCount, settings.sceneCount);
+				RunScenario(scenario, bodyCount, threadCount, settings, pOutput);
+			}
+		}
+	}
+
+	return true;
+}
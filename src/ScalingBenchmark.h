@@ -0,0 +1,27 @@
+#pragma once
+
+#include "PhysicsScene.h"
+
+#include <cstddef>
+#include <cstdio>
+
+struct ScalingBenchmarkSettings
+{
+	const char* pScenario = nullptr;	// Null runs every scenario
+	PhysicsScene::BroadphaseType broadphase = PhysicsScene::BroadphaseType::SweepAndPrune;
+	size_t minBodyCount = 1000;
+	size_t maxBodyCount = 1000000;		// Body counts go up ten times at a time
+	unsigned int maxThreadCount = 0;	// Thread counts double up to this, zero uses every hardware thread
+	int sceneCount = 1;					// Copies of the scene stepped alongside each other
+	int warmupStepCount = 10;			// Not timed, lets the bodies start to collide
+	int stepCount = 30;
+	const char* pTracePath = nullptr;	// Writes a Chrome trace of the last run's timed steps
+};
+
+// Steps scripted scenes at each body count and thread count and writes the mean time of each
+//   step phase as CSV, one row per run. Progress goes to stderr.
+// With more than one scene, the copies are stepped in parallel by a SceneScheduler. Each row
+//   is per scene, apart from the time all of the scenes took together.
+// Returns false if the scenario named isn't one of them.
+// Run with PhysicsBenchmark, which builds without a renderer.
+bool RunScalingBenchmark(const ScalingBenchmarkSettings& settings, FILE* pOutput);
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "HandleTable.h"
+
+#include <cstdint>
+#include <glm/vec3.hpp>
+
+// Queries only find bodies on a layer in their mask, see PhysicsScene::SetCollisionFilter
+static const uint32_t AllQueryLayers = UINT32_MAX;
+
+// The first body a ray or a sweep hit
+struct QueryHit
+{
+	BodyHandle handle;	// Invalid when nothing was hit
+	glm::vec3 position;	// Where the surfaces touch
+	glm::vec3 normal;	// Of the surface hit, facing back along the query
+	float distance;		// Along the query's direction
+
+	bool IsHit() const { return handle != BodyHandle::Invalid(); }
+};
+
+struct RaycastQuery
+{
+	glm::vec3 origin;
+	glm::vec3 direction;
+	float maxDistance;
+	uint32_t layerMask;
+};
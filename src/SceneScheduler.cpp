@@ -0,0 +1,49 @@
+#include "SceneScheduler.h"
+
+#include "BasePhysicsScene.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <chrono>
+
+
+static double GetMilliseconds(Profiler::Clock::time_point startTime, Profiler::Clock::time_point endTime)
+{
+	return std::chrono::duration<double, std::milli>(endTime - startTime).count();
+}
+
+size_t SceneScheduler::AddScene(BasePhysicsScene* pScene)
+{
+	m_scenes.push_back(ScheduledScene{ pScene, SceneStats() });
+	return m_scenes.size() - 1;
+}
+
+void SceneScheduler::RemoveScene(BasePhysicsScene* pScene)
+{
+	m_scenes.erase(std::remove_if(m_scenes.begin(), m_scenes.end(), [pScene](const ScheduledScene& scene) { return scene.pScene == pScene; }), m_scenes.end());
+}
+
+void SceneScheduler::Update(float deltaTime)
+{
+	Profiler::Clock::time_point startTime = Profiler::Clock::now();
+
+	// Each job only touches its own scene and stats
+	JobSystem::JobCounter counter(0);
+	for (ScheduledScene& scene : m_scenes)
+	{
+		ScheduledScene* pScheduledScene = &scene;
+		m_jobSystem.Run([pScheduledScene, deltaTime]() {
+			Profiler::Clock::time_point sceneStartTime = Profiler::Clock::now();
+			pScheduledScene->pScene->Update(deltaTime);
+
+			SceneStats& stats = pScheduledScene->stats;
+			stats.updateTime = GetMilliseconds(sceneStartTime, Profiler::Clock::now());
+			stats.totalTime += stats.updateTime;
+			stats.updateCount++;
+		}, counter);
+	}
+	m_jobSystem.Wait(counter);
+
+	m_updateTime = GetMilliseconds(startTime, Profiler::Clock::now());
+}
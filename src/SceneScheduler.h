@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+class BasePhysicsScene;
+class JobSystem;
+
+// Updates scenes that share nothing with each other at the same time, one job per scene on
+//   the job system. Scenes that use the same job system split their own work across it too.
+// Update is the join point, it returns once every scene has finished so they can be drawn.
+// The scheduler doesn't own the scenes or the job system.
+class SceneScheduler
+{
+public:
+	struct SceneStats
+	{
+		// Milliseconds, from the job starting to the scene's Update returning. Includes any
+		//   jobs of other scenes the thread ran while the scene waited on its own.
+		double updateTime;		// In the last Update
+		double totalTime;		// Over every Update
+		int updateCount;
+	};
+
+	explicit SceneScheduler(JobSystem& jobSystem) : m_jobSystem(jobSystem) {}
+
+	// Scenes are indexed in the order they're added
+	size_t AddScene(BasePhysicsScene* pScene);
+	void RemoveScene(BasePhysicsScene* pScene);
+	size_t GetSceneCount() const { return m_scenes.size(); }
+
+	void Update(float deltaTime);
+
+	const SceneStats& GetSceneStats(size_t sceneIndex) const { return m_scenes[sceneIndex].stats; }
+	// Milliseconds the last Update took as a whole. Less than the scenes' summed times when
+	//   they ran alongside each other.
+	double GetUpdateTime() const { return m_updateTime; }
+
+private:
+	struct ScheduledScene
+	{
+		BasePhysicsScene* pScene;
+		SceneStats stats;
+	};
+
+	JobSystem& m_jobSystem;
+	std::vector<ScheduledScene> m_scenes;
+	double m_updateTime = 0;
+};
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <glm/vec3.hpp>
+
+// Draws shapes for a scene. The physics only calls through this, so it builds and runs
+//   without a renderer or a window.
+class ShapeDrawer
+{
+public:
+	virtual ~ShapeDrawer() {}
+
+	virtual void DrawSphere(glm::vec3 position, float radius) = 0;
+	virtual void DrawAABB(glm::vec3 position, glm::vec3 extents) = 0;
+	virtual void DrawPlane(glm::vec3 position, glm::vec3 normal, float distance) = 0;
+};
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "ObjectPool.h"
+#include "Shapes.h"
+
+#include <initializer_list>
+#include <utility>
+
+// A pool for each type of shape. Shapes made from it stay next to others of their type, and
+//   once the pools have grown to fit, adding and removing bodies doesn't touch the heap.
+class ShapePool
+{
+public:
+	template<typename T, typename... Args>
+	T* Create(Args&&... args) { return GetPool(static_cast<T*>(nullptr)).Create(std::forward<Args>(args)...); }
+
+	// Must have come from this pool
+	void Destroy(Shape* pShape)
+	{
+		switch (static_cast<Shape::ID>(pShape->GetID()))
+		{
+		case Shape::ID::Plane: m_planes.Destroy(static_cast<Plane*>(pShape)); break;
+		case Shape::ID::Sphere: m_spheres.Destroy(static_cast<Sphere*>(pShape)); break;
+		case Shape::ID::AABB: m_aabbs.Destroy(static_cast<AABB*>(pShape)); break;
+		default: assert(false); break;
+		}
+	}
+
+	// Summed over every type of shape
+	PoolStats GetStats() const
+	{
+		PoolStats stats = m_planes.GetStats();
+		for (const PoolStats& typeStats : { m_spheres.GetStats(), m_aabbs.GetStats() })
+		{
+			stats.liveCount += typeStats.liveCount;
+			stats.capacity += typeStats.capacity;
+			stats.slabAllocations += typeStats.slabAllocations;
+		}
+		return stats;
+	}
+
+private:
+	// Scenes rarely have more than a few planes
+	ObjectPool<Plane, 16>& GetPool(Plane*) { return m_planes; }
+	ObjectPool<Sphere>& GetPool(Sphere*) { return m_spheres; }
+	ObjectPool<AABB>& GetPool(AABB*) { return m_aabbs; }
+
+	ObjectPool<Plane, 16> m_planes;
+	ObjectPool<Sphere> m_spheres;
+	ObjectPool<AABB> m_aabbs;
+};
@@ -1,19 +1,20 @@
 #pragma once
 
-#include "Gizmos.h"
-#include <glm\vec3.hpp>
-#include <glm\vec4.hpp>
+#include "Bounds.h"
+#include "ShapeDrawer.h"
+#include <glm/vec3.hpp>
 
 class Shape
 {
 public:
+	enum class ID { Plane, Sphere, AABB, Count };
+
 	static constexpr int GetShapeCount() { return static_cast<int>(ID::Count); }
 	int GetID() const { return static_cast<int>(m_id); }
-    virtual void Draw( glm::vec3 position ) const = 0;
+	virtual Bounds GetBounds(glm::vec3 position) const = 0;
+    virtual void Draw(ShapeDrawer& drawer, glm::vec3 position) const = 0;
 
 protected:
-	enum class ID { Plane, Sphere, AABB, Count };
-
 	Shape(ID id) : m_id(id) {}
 
 private:
@@ -24,6 +25,8 @@ private:
 class Sphere : public Shape
 {
 public:
+	static constexpr ID TypeID = ID::Sphere;
+
     Sphere(float radius) :
 		Shape(ID::Sphere),
         m_radius(radius)
@@ -31,9 +34,14 @@ public:
 
 	float GetRadius() const { return m_radius; }
 
-    void Draw(glm::vec3 position) const override
+	Bounds GetBounds(glm::vec3 position) const override
+	{
+		return Bounds{ position - m_radius, position + m_radius };
+	}
+
+    void Draw(ShapeDrawer& drawer, glm::vec3 position) const override
     {
-        Gizmos::addSphereFilled(position, m_radius, 10, 10, glm::vec4(0.5f, 0, 0, 1));
+        drawer.DrawSphere(position, m_radius);
     }
 
 private:
@@ -44,13 +52,20 @@ private:
 class AABB : public Shape
 {
 public:
+	static constexpr ID TypeID = ID::AABB;
+
 	AABB( glm::vec3 extents ) : Shape(ID::AABB), m_extents(extents) {}
 
 	glm::vec3 GetExtents() const { return m_extents; }
 
-    void Draw(glm::vec3 position) const override
+	Bounds GetBounds(glm::vec3 position) const override
+	{
+		return Bounds{ position - m_extents, position + m_extents };
+	}
+
+    void Draw(ShapeDrawer& drawer, glm::vec3 position) const override
     {
-		Gizmos::addAABBFilled(position, m_extents, glm::vec4(0, 0.5f, 0, 1));
+		drawer.DrawAABB(position, m_extents);
     }
 
 private:
@@ -61,6 +76,8 @@ private:
 class Plane : public Shape
 {
 public:
+	static constexpr ID TypeID = ID::Plane;
+
     Plane(glm::vec3 normal, float distance) :
 		Shape(ID::Plane),
         m_normal(normal),
@@ -70,9 +87,12 @@ public:
 	glm::vec3 GetNormal() const { return m_normal; }
 	float GetDistance() const { return m_distance;  }
 
-    void Draw(glm::vec3 position) const override
+	// Anything behind the plane is colliding with it, so it covers all of space
+	Bounds GetBounds(glm::vec3) const override { return Bounds::Infinite(); }
+
+    void Draw(ShapeDrawer& drawer, glm::vec3 position) const override
     {
-        Gizmos::addAABBFilled(position, glm::vec3(100.f, 0.f, 100.f), glm::vec4(0.25f, 0.25f, 0.25f, 1));
+        drawer.DrawPlane(position, m_normal, m_distance);
     }
 
 private:
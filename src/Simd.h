@@ -0,0 +1,6 @@
+#pragma once
+
+// Define PHYSICS_NO_SIMD to build only the scalar kernels.
+#if !defined(PHYSICS_NO_SIMD) && (defined(__AVX__) || defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define PHYSICS_SIMD 1
+#endif
@@ -0,0 +1,202 @@
+#include "SimulationRecorder.h"
+
+#include "Snapshot.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+
+bool SimulationRecorder::Start(const char* pPath, const RecorderSettings& settings)
+{
+	Stop();
+
+	m_pFile = fopen(pPath, "wb");
+	if (m_pFile == nullptr) return false;
+
+	m_settings = settings;
+	m_settings.keyframeInterval = std::max(m_settings.keyframeInterval, 1);
+	m_settings.queueCapacity = std::max<size_t>(m_settings.queueCapacity, 1);
+
+	m_step = 0;
+	m_framesSinceKeyframe = 0;
+	m_isKeyframeNeeded = true;
+	m_stats = Stats{};
+
+	RecordingHeader header = { RecordingHeader::Magic, RecordingHeader::Version, m_settings.positionPrecision, m_settings.velocityPrecision };
+	if (fwrite(&header, sizeof(header), 1, m_pFile) == 1) {
+		m_stats.bytesWritten = sizeof(header);
+	}
+	else {
+		m_stats.hasWriteFailed = true;
+	}
+
+	m_isStopping = false;
+	m_writeThread = std::thread(&SimulationRecorder::WriteFrames, this);
+	return true;
+}
+
+void SimulationRecorder::Stop()
+{
+	if (m_pFile == nullptr) return;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_isStopping = true;
+	}
+	m_frameQueued.notify_one();
+	m_writeThread.join();
+
+	if (fclose(m_pFile) != 0) {
+		m_stats.hasWriteFailed = true;
+	}
+	m_pFile = nullptr;
+}
+
+SimulationRecorder::Stats SimulationRecorder::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_stats;
+}
+
+void SimulationRecorder::Record(size_t bodyCount, const BodyHandle* handles, const glm::vec3* positions, const glm::vec3* velocities)
+{
+	if (m_pFile == nullptr) return;
+
+	const uint64_t step = m_step++;
+
+	std::vector<uint8_t> buffer;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stats.framesRecorded++;
+
+		// The next delta would be from a frame that was never written
+		if (m_queuedFrames.size() >= m_settings.queueCapacity) {
+			m_stats.framesDropped++;
+			m_isKeyframeNeeded = true;
+			return;
+		}
+
+		if (!m_freeBuffers.empty()) {
+			buffer = std::move(m_freeBuffers.back());
+			m_freeBuffers.pop_back();
+		}
+	}
+
+	// The payload goes after the header, which is filled in once its size is known
+	buffer.assign(sizeof(RecordingFrameHeader), 0);
+
+	bool isKeyframe = m_isKeyframeNeeded || m_framesSinceKeyframe + 1 >= m_settings.keyframeInterval ||
+		bodyCount != m_handles.size() || !std::equal(handles, handles + bodyCount, std::begin(m_handles));
+	if (!isKeyframe && !EncodeDelta(bodyCount, positions, velocities, buffer)) {
+		isKeyframe = true;
+	}
+
+	if (isKeyframe) {
+		EncodeKeyframe(bodyCount, handles, positions, velocities, buffer);
+		m_isKeyframeNeeded = false;
+		m_framesSinceKeyframe = 0;
+	}
+	else {
+		m_framesSinceKeyframe++;
+	}
+
+	buffer.resize((buffer.size() + SnapshotWriter::Alignment - 1) / SnapshotWriter::Alignment * SnapshotWriter::Alignment, 0);
+
+	RecordingFrameHeader header = {};
+	header.type = isKeyframe ? RecordingFrameHeader::Keyframe : RecordingFrameHeader::Delta;
+	header.bodyCount = static_cast<uint32_t>(bodyCount);
+	header.step = step;
+	header.size = buffer.size() - sizeof(RecordingFrameHeader);
+	memcpy(buffer.data(), &header, sizeof(header));
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_queuedFrames.push_back(std::move(buffer));
+		if (isKeyframe) {
+			m_stats.keyframes++;
+		}
+	}
+	m_frameQueued.notify_one();
+}
+
+// Steps of the precision from the value as it was last decoded, or false if it doesn't fit
+static bool Quantize(float value, float decodedValue, float precision, int16_t& delta)
+{
+	float steps = std::floor((value - decodedValue) / precision + 0.5f);
+	// Also false for NaN
+	if (!(steps >= -INT16_MAX && steps <= INT16_MAX)) return false;
+
+	delta = static_cast<int16_t>(steps);
+	return true;
+}
+
+bool SimulationRecorder::EncodeDelta(size_t bodyCount, const glm::vec3* positions, const glm::vec3* velocities, std::vector<uint8_t>& buffer)
+{
+	m_positionDeltas.resize(bodyCount * 3);
+	m_velocityDeltas.resize(bodyCount * 3);
+
+	for (size_t i = 0; i < bodyCount; i++)
+	{
+		for (int axis = 0; axis < 3; axis++)
+		{
+			if (!Quantize(positions[i][axis], m_positions[i][axis], m_settings.positionPrecision, m_positionDeltas[i * 3 + axis]) ||
+				!Quantize(velocities[i][axis], m_velocities[i][axis], m_settings.velocityPrecision, m_velocityDeltas[i * 3 + axis])) {
+				return false;
+			}
+		}
+	}
+
+	// Every change fits, so move on to the values the reader will decode
+	for (size_t i = 0; i < bodyCount; i++)
+	{
+		for (int axis = 0; axis < 3; axis++)
+		{
+			m_positions[i][axis] += static_cast<float>(m_positionDeltas[i * 3 + axis]) * m_settings.positionPrecision;
+			m_velocities[i][axis] += static_cast<float>(m_velocityDeltas[i * 3 + axis]) * m_settings.velocityPrecision;
+		}
+	}
+
+	SnapshotWriter writer(buffer);
+	writer.WriteArray(m_positionDeltas);
+	writer.WriteArray(m_velocityDeltas);
+	return true;
+}
+
+void SimulationRecorder::EncodeKeyframe(size_t bodyCount, const BodyHandle* handles, const glm::vec3* positions, const glm::vec3* velocities, std::vector<uint8_t>& buffer)
+{
+	m_handles.assign(handles, handles + bodyCount);
+	m_positions.assign(positions, positions + bodyCount);
+	m_velocities.assign(velocities, velocities + bodyCount);
+
+	SnapshotWriter writer(buffer);
+	writer.WriteArray(m_handles);
+	writer.WriteArray(m_positions);
+	writer.WriteArray(m_velocities);
+}
+
+void SimulationRecorder::WriteFrames()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	for (;;)
+	{
+		m_frameQueued.wait(lock, [this]() { return !m_queuedFrames.empty() || m_isStopping; });
+		// Only stops once everything queued has been written
+		if (m_queuedFrames.empty()) return;
+
+		std::vector<uint8_t> buffer = std::move(m_queuedFrames.front());
+		m_queuedFrames.pop_front();
+
+		lock.unlock();
+		bool isWritten = fwrite(buffer.data(), 1, buffer.size(), m_pFile) == buffer.size();
+		lock.lock();
+
+		if (isWritten) {
+			m_stats.bytesWritten += buffer.size();
+		}
+		else {
+			m_stats.hasWriteFailed = true;
+		}
+		m_freeBuffers.push_back(std::move(buffer));
+	}
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "HandleTable.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <glm/vec3.hpp>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Recordings start with a header, followed by one frame per step. Each frame is a frame
+//   header and a payload, padded to 16 bytes so every payload starts aligned.
+// Keyframes hold the handle, position and velocity of every body. Delta frames hold the
+//   change since the frame before in steps of the precision, as 16 bit integers, and are
+//   only written while the bodies are the same ones in the same order.
+// Deltas are taken from the values as they'll be decoded, not as they were, so the error
+//   stays within the precision rather than building up between keyframes.
+struct RecordingHeader
+{
+	static const uint32_t Magic = 0x43455250; // "PREC" read as little endian
+	static const uint32_t Version = 1;
+
+	uint32_t magic;
+	uint32_t version;
+	float positionPrecision;
+	float velocityPrecision;
+};
+
+struct RecordingFrameHeader
+{
+	enum Type : uint32_t { Keyframe, Delta };
+
+	uint32_t type;
+	uint32_t bodyCount;
+	uint64_t step;	// Counts every recorded step, including those dropped, so gaps show
+	uint64_t size;	// Of the payload after this header
+	uint64_t reserved;
+};
+
+
+struct RecorderSettings
+{
+	int keyframeInterval = 60;			// Steps between keyframes
+	float positionPrecision = 0.001f;	// Changes are rounded to this, see RecordingHeader
+	float velocityPrecision = 0.01f;
+	size_t queueCapacity = 16;			// Frames waiting to be written
+};
+
+// Records the bodies of a scene every step, to be played back with RecordingReader.
+// Frames are encoded on the stepping thread and written to disk on a thread of the
+//   recorder's own, through a queue of a fixed number of frames. If the disk falls behind
+//   and the queue is full, the frame is dropped rather than stalling the step, and the next
+//   frame is a keyframe.
+// Record must only be called from one thread at a time.
+class SimulationRecorder
+{
+public:
+	struct Stats
+	{
+		uint64_t framesRecorded;	// Including those dropped
+		uint64_t keyframes;
+		uint64_t framesDropped;
+		uint64_t bytesWritten;
+		bool hasWriteFailed;
+	};
+
+	SimulationRecorder() {}
+	~SimulationRecorder() { Stop(); }
+
+	SimulationRecorder(const SimulationRecorder&) = delete;
+	SimulationRecorder& operator=(const SimulationRecorder&) = delete;
+
+	// Returns false if the file couldn't be created
+	bool Start(const char* pPath, const RecorderSettings& settings = RecorderSettings());
+	// Waits for every queued frame to be written, then closes the file
+	void Stop();
+	bool IsRecording() const { return m_pFile != nullptr; }
+
+	// Does nothing unless recording
+	void Record(size_t bodyCount, const BodyHandle* handles, const glm::vec3* positions, const glm::vec3* velocities);
+
+	Stats GetStats() const;
+
+private:
+	// Returns false if a change is too large for a delta, or isn't a number
+	bool EncodeDelta(size_t bodyCount, const glm::vec3* positions, const glm::vec3* velocities, std::vector<uint8_t>& buffer);
+	void EncodeKeyframe(size_t bodyCount, const BodyHandle* handles, const glm::vec3* positions, const glm::vec3* velocities, std::vector<uint8_t>& buffer);
+	void WriteFrames();
+
+	RecorderSettings m_settings;
+	FILE* m_pFile = nullptr;
+
+	// Only used by the recording thread.
+	// The bodies as the last frame decodes, deltas are taken from these.
+	uint64_t m_step = 0;
+	int m_framesSinceKeyframe = 0;
+	bool m_isKeyframeNeeded = true;
+	std::vector<BodyHandle> m_handles;
+	std::vector<glm::vec3> m_positions;
+	std::vector<glm::vec3> m_velocities;
+	std::vector<int16_t> m_positionDeltas;
+	std::vector<int16_t> m_velocityDeltas;
+
+	// Shared with the writing thread
+	mutable std::mutex m_mutex;
+	std::condition_variable m_frameQueued;
+	std::deque<std::vector<uint8_t>> m_queuedFrames;
+	std::vector<std::vector<uint8_t>> m_freeBuffers; // Reused, so recording doesn't allocate once it's going
+	bool m_isStopping = false;
+	Stats m_stats = {};
+	std::thread m_writeThread;
+};
@@ -0,0 +1,56 @@
+#include "SimulationThread.h"
+
+#include "PhysicsScene.h"
+
+
+SimulationThread::SimulationThread(PhysicsScene& scene) :
+	m_scene(scene)
+{
+	m_thread = std::thread(&SimulationThread::StepLoop, this);
+}
+
+SimulationThread::~SimulationThread()
+{
+	Wait();
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_isStopping = true;
+	}
+	m_condition.notify_all();
+	m_thread.join();
+}
+
+void SimulationThread::Update(float deltaTime)
+{
+	Wait();
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_deltaTime = deltaTime;
+		m_isUpdating = true;
+	}
+	m_condition.notify_all();
+}
+
+void SimulationThread::Wait()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_condition.wait(lock, [this]() { return !m_isUpdating; });
+}
+
+void SimulationThread::StepLoop()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (true)
+	{
+		m_condition.wait(lock, [this]() { return m_isUpdating || m_isStopping; });
+		if (m_isStopping) break;
+
+		float deltaTime = m_deltaTime;
+		lock.unlock();
+		m_scene.Update(deltaTime);
+		lock.lock();
+
+		m_isUpdating = false;
+		m_condition.notify_all();
+	}
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+class PhysicsScene;
+
+// Steps a scene on a thread of its own, so the step runs alongside whatever the calling
+//   thread does next, like rendering.
+// Update hands the frame's time to the thread and returns straight away. Until Wait returns
+//   the scene can only be drawn, Draw reads what the last finished Update left for it.
+// The scene steps with whatever job system it was given. While it steps, the stepping thread
+//   stands in for thread 0 of the pool, so no other thread outside the pool may use it until
+//   Wait returns.
+class SimulationThread
+{
+public:
+	explicit SimulationThread(PhysicsScene& scene);
+	// Waits for the last Update to finish
+	~SimulationThread();
+
+	SimulationThread(const SimulationThread&) = delete;
+	SimulationThread& operator=(const SimulationThread&) = delete;
+
+	// Waits for the last Update to finish first, so they never overlap
+	void Update(float deltaTime);
+	// Returns once the scene is done stepping, it can then be changed until the next Update
+	void Wait();
+
+private:
+	void StepLoop();
+
+	PhysicsScene& m_scene;
+
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	float m_deltaTime = 0;
+	bool m_isUpdating = false;
+	bool m_isStopping = false;
+	std::thread m_thread;
+};
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+// Scene snapshots are the state of every body written out array by array, in the same
+//   layout as in memory, so restoring one is a copy per array rather than a call per body.
+// Each array starts on a 16 byte boundary. Values are in the byte order of the machine
+//   that wrote them, a snapshot from the other byte order fails the magic number check.
+// Bump the version whenever the layout changes, older snapshots are then refused.
+struct SnapshotHeader
+{
+	static const uint32_t Magic = 0x50534E50; // "PNSP" read as little endian
+	static const uint32_t Version = 1;
+
+	uint32_t magic;
+	uint32_t version;
+	uint64_t size; // Of the whole snapshot, including the header
+};
+
+
+// Appends values and arrays to a buffer
+class SnapshotWriter
+{
+public:
+	static const size_t Alignment = 16;
+
+	explicit SnapshotWriter(std::vector<uint8_t>& data) : m_data(data) {}
+
+	template<typename T>
+	void Write(const T& value)
+	{
+		WriteBytes(&value, sizeof(T));
+	}
+
+	// Written after its count
+	template<typename T>
+	void WriteArray(const T* pValues, size_t count)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "Only plain data can be written");
+
+		Write(static_cast<uint64_t>(count));
+		m_data.resize((m_data.size() + Alignment - 1) / Alignment * Alignment, 0);
+		WriteBytes(pValues, count * sizeof(T));
+	}
+
+	template<typename T>
+	void WriteArray(const std::vector<T>& values)
+	{
+		WriteArray(values.data(), values.size());
+	}
+
+private:
+	void WriteBytes(const void* pBytes, size_t size)
+	{
+		size_t offset = m_data.size();
+		m_data.resize(offset + size);
+		if (size > 0) {
+			memcpy(&m_data[offset], pBytes, size);
+		}
+	}
+
+	std::vector<uint8_t>& m_data;
+};
+
+
+// Reads back what a SnapshotWriter wrote, in the same order.
+// Arrays are read in place, without copying them. Every read checks it stays inside the
+//   data, and fails rather than reading past the end of a truncated snapshot.
+class SnapshotReader
+{
+public:
+	SnapshotReader(const void* pData, size_t size) : m_pData(static_cast<const uint8_t*>(pData)), m_size(size) {}
+
+	template<typename T>
+	bool Read(T& value)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "Only plain data can be read");
+
+		if (m_size - m_offset < sizeof(T)) return false;
+		memcpy(&value, m_pData + m_offset, sizeof(T));
+		m_offset += sizeof(T);
+		return true;
+	}
+
+	// Points into the snapshot's data, valid as long as it is. Null if the data is too short.
+	// The count is checked against an expected count, unless that's SIZE_MAX.
+	template<typename T>
+	const T* ReadArray(size_t& count, size_t expectedCount = SIZE_MAX)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "Only plain data can be read");
+
+		uint64_t storedCount;
+		if (!Read(storedCount)) return nullptr;
+		if (expectedCount != SIZE_MAX && storedCount != expectedCount) return nullptr;
+
+		size_t offset = (m_offset + SnapshotWriter::Alignment - 1) / SnapshotWriter::Alignment * SnapshotWriter::Alignment;
+		if (offset > m_size || storedCount > (m_size - offset) / sizeof(T)) return nullptr;
+
+		count = static_cast<size_t>(storedCount);
+		m_offset = offset + count * sizeof(T);
+		return reinterpret_cast<const T*>(m_pData + offset);
+	}
+
+	// Replaces the vector's contents with the next array
+	template<typename T>
+	bool ReadArray(std::vector<T>& values, size_t expectedCount = SIZE_MAX)
+	{
+		size_t count;
+		const T* pValues = ReadArray<T>(count, expectedCount);
+		if (pValues == nullptr) return false;
+
+		values.assign(pValues, pValues + count);
+		return true;
+	}
+
+private:
+	const uint8_t* m_pData;
+	size_t m_size;
+	size_t m_offset = 0;
+};
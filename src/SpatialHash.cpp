@@ -0,0 +1,205 @@
+#include "SpatialHash.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <cmath>
+#include <glm/glm.hpp>
+
+constexpr float SpatialHash::DefaultCellSize;
+
+
+void SpatialHash::Add(uint32_t id, const Bounds& bounds, bool isStatic)
+{
+	if (id >= m_proxies.size()) {
+		m_proxies.resize(id + 1);
+	}
+
+	Proxy& proxy = m_proxies[id];
+	proxy.bounds = bounds;
+	proxy.isStatic = isStatic;
+	proxy.isActive = true;
+}
+
+void SpatialHash::Remove(uint32_t id)
+{
+	assert(id < m_proxies.size() && m_proxies[id].isActive);
+	m_proxies[id].isActive = false;
+}
+
+void SpatialHash::Update(uint32_t id, const Bounds& bounds)
+{
+	assert(id < m_proxies.size());
+	m_proxies[id].bounds = bounds;
+}
+
+void SpatialHash::SetStatic(uint32_t id, bool isStatic)
+{
+	assert(id < m_proxies.size());
+	m_proxies[id].isStatic = isStatic;
+}
+
+void SpatialHash::FindPairs(std::vector<BroadphasePair>& pairs)
+{
+	size_t firstPair = pairs.size();
+
+	BuildTable();
+	FindPairsInBuckets(pairs);
+	FindOversizedPairs(pairs);
+
+	m_stats.oversizedBodies = static_cast<uint32_t>(m_oversized.size());
+	m_stats.candidatePairs = static_cast<uint32_t>(pairs.size() - firstPair);
+}
+
+SpatialHash::CellCoord SpatialHash::GetCell(glm::vec3 position) const
+{
+	return CellCoord{
+		static_cast<int>(std::floor(position.x / m_cellSize)),
+		static_cast<int>(std::floor(position.y / m_cellSize)),
+		static_cast<int>(std::floor(position.z / m_cellSize))
+	};
+}
+
+uint32_t SpatialHash::GetBucket(const CellCoord& cell) const
+{
+	// Large primes from "Optimized Spatial Hashing for Collision Detection of Deformable Objects"
+	uint32_t hash = (static_cast<uint32_t>(cell.x) * 73856093u) ^
+		(static_cast<uint32_t>(cell.y) * 19349663u) ^
+		(static_cast<uint32_t>(cell.z) * 83492791u);
+	return hash & m_bucketMask;
+}
+
+void SpatialHash::BuildTable()
+{
+	// Keep about two buckets per body, a power of two so the hash can be masked
+	uint32_t bucketCount = 1;
+	while (bucketCount < m_proxies.size() * 2) bucketCount <<= 1;
+	m_bucketMask = bucketCount - 1;
+
+	m_bucketStarts.assign(bucketCount + 1, 0);
+	m_oversized.clear();
+
+	// Count the entries in each bucket
+	uint32_t entryCount = 0;
+	for (uint32_t id = 0; id < m_proxies.size(); id++)
+	{
+		Proxy& proxy = m_proxies[id];
+		if (!proxy.isActive) {
+			proxy.isOversized = false;
+			proxy.minCell = CellCoord{ 0, 0, 0 };
+			proxy.maxCell = CellCoord{ -1, -1, -1 };
+			continue;
+		}
+
+		// Count the cells in floating point, the bounds of a plane won't fit in an int.
+		glm::vec3 cellSpan = glm::floor(proxy.bounds.max / m_cellSize) - glm::floor(proxy.bounds.min / m_cellSize) + 1.0f;
+		// Written so that bounds which aren't finite also count as oversized
+		proxy.isOversized = !(cellSpan.x * cellSpan.y * cellSpan.z <= MaxCellsPerBody);
+		if (proxy.isOversized) {
+			m_oversized.push_back(id);
+			continue;
+		}
+
+		proxy.minCell = GetCell(proxy.bounds.min);
+		proxy.maxCell = GetCell(proxy.bounds.max);
+		for (int x = proxy.minCell.x; x <= proxy.maxCell.x; x++)
+			for (int y = proxy.minCell.y; y <= proxy.maxCell.y; y++)
+				for (int z = proxy.minCell.z; z <= proxy.maxCell.z; z++)
+				{
+					m_bucketStarts[GetBucket(CellCoord{ x, y, z }) + 1]++;
+					entryCount++;
+				}
+	}
+
+	for (uint32_t bucket = 0; bucket < bucketCount; bucket++)
+	{
+		m_bucketStarts[bucket + 1] += m_bucketStarts[bucket];
+	}
+
+	// Place each entry in its bucket
+	m_entries.resize(entryCount);
+	m_bucketCursors.assign(std::begin(m_bucketStarts), std::end(m_bucketStarts));
+	for (uint32_t id = 0; id < m_proxies.size(); id++)
+	{
+		const Proxy& proxy = m_proxies[id];
+		if (proxy.isOversized) continue;
+
+		for (int x = proxy.minCell.x; x <= proxy.maxCell.x; x++)
+			for (int y = proxy.minCell.y; y <= proxy.maxCell.y; y++)
+				for (int z = proxy.minCell.z; z <= proxy.maxCell.z; z++)
+				{
+					CellCoord cell{ x, y, z };
+					m_entries[m_bucketCursors[GetBucket(cell)]++] = Entry{ id, cell };
+				}
+	}
+}
+
+void SpatialHash::FindPairsInBuckets(std::vector<BroadphasePair>& pairs)
+{
+	m_stats.occupiedCells = 0;
+	m_stats.maxCellOccupancy = 0;
+
+	for (uint32_t bucket = 0; bucket <= m_bucketMask; bucket++)
+	{
+		uint32_t start = m_bucketStarts[bucket];
+		uint32_t end = m_bucketStarts[bucket + 1];
+		if (start == end) continue;
+
+		for (uint32_t i = start; i < end; i++)
+		{
+			const Entry& entry1 = m_entries[i];
+			const Proxy& proxy1 = m_proxies[entry1.id];
+
+			// Entries after this one in the same cell. The cell's first entry sees every other
+			//   entry in it, and its last entry sees none, so each cell is counted once.
+			uint32_t laterEntries = 0;
+
+			for (uint32_t j = i + 1; j < end; j++)
+			{
+				const Entry& entry2 = m_entries[j];
+				const Proxy& proxy2 = m_proxies[entry2.id];
+
+				// Different cells can hash to the same bucket
+				if (!(entry1.cell == entry2.cell)) continue;
+				laterEntries++;
+
+				if (proxy1.isStatic && proxy2.isStatic) continue;
+				if (!proxy1.bounds.Overlaps(proxy2.bounds)) continue;
+
+				// Bodies that share several cells only report the pair from the cell
+				//   holding the min corner of their overlap.
+				glm::vec3 overlapMin = glm::max(proxy1.bounds.min, proxy2.bounds.min);
+				if (!(GetCell(overlapMin) == entry1.cell)) continue;
+
+				pairs.push_back(entry1.id < entry2.id ?
+					BroadphasePair{ entry1.id, entry2.id } : BroadphasePair{ entry2.id, entry1.id });
+			}
+
+			if (laterEntries == 0) m_stats.occupiedCells++;
+			m_stats.maxCellOccupancy = std::max(m_stats.maxCellOccupancy, laterEntries + 1);
+		}
+	}
+
+	m_stats.averageCellOccupancy = m_stats.occupiedCells == 0 ? 0 :
+		static_cast<float>(m_entries.size()) / m_stats.occupiedCells;
+}
+
+void SpatialHash::FindOversizedPairs(std::vector<BroadphasePair>& pairs)
+{
+	for (uint32_t oversizedId : m_oversized)
+	{
+		const Proxy& oversizedProxy = m_proxies[oversizedId];
+
+		for (uint32_t id = 0; id < m_proxies.size(); id++)
+		{
+			const Proxy& proxy = m_proxies[id];
+			if (!proxy.isActive) continue;
+
+			// Pairs of oversized bodies are found once, from the lower id
+			if (proxy.isOversized && id <= oversizedId) continue;
+			if (proxy.isStatic && oversizedProxy.isStatic) continue;
+			if (!proxy.bounds.Overlaps(oversizedProxy.bounds)) continue;
+
+			pairs.push_back(id < oversizedId ? BroadphasePair{ id, oversizedId } : BroadphasePair{ oversizedId, id });
+		}
+	}
+}
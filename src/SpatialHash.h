@@ -0,0 +1,84 @@
+#pragma once
+
+#include "Broadphase.h"
+
+// Buckets bodies into a uniform grid of cells that is hashed into a fixed size table.
+// Works best when bodies are all about the size of a cell. Bodies that cover too many cells,
+//   like planes and walls, are kept in an oversized list and tested against everything.
+// The table is rebuilt every step into storage kept from the last step, so once the
+//   scene stops growing nothing is allocated.
+class SpatialHash : public Broadphase
+{
+public:
+	static constexpr float DefaultCellSize = 2.0f;
+
+	// Bodies covering more cells than this go in the oversized list
+	static const int MaxCellsPerBody = 27;
+
+	// Cells that hash to the same bucket are still counted apart
+	struct Stats
+	{
+		uint32_t occupiedCells;
+		uint32_t maxCellOccupancy;
+		float averageCellOccupancy;
+		uint32_t oversizedBodies;
+		uint32_t candidatePairs;
+	};
+
+	SpatialHash(float cellSize = DefaultCellSize) : m_cellSize(cellSize), m_stats() {}
+
+	void SetCellSize(float cellSize) { m_cellSize = cellSize; }
+	float GetCellSize() const { return m_cellSize; }
+
+	// Stats from the last call to FindPairs
+	const Stats& GetStats() const { return m_stats; }
+
+	void Add(uint32_t id, const Bounds& bounds, bool isStatic) override;
+	void Remove(uint32_t id) override;
+	void Update(uint32_t id, const Bounds& bounds) override;
+	void SetStatic(uint32_t id, bool isStatic) override;
+	void FindPairs(std::vector<BroadphasePair>& pairs) override;
+
+private:
+	struct CellCoord
+	{
+		int x, y, z;
+
+		bool operator==(const CellCoord& other) const { return x == other.x && y == other.y && z == other.z; }
+	};
+
+	struct Proxy
+	{
+		Bounds bounds;
+		bool isStatic;
+		bool isActive;
+		bool isOversized;
+		CellCoord minCell;
+		CellCoord maxCell;
+	};
+
+	// One for each cell a body touches
+	struct Entry
+	{
+		uint32_t id;
+		CellCoord cell;
+	};
+
+	CellCoord GetCell(glm::vec3 position) const;
+	uint32_t GetBucket(const CellCoord& cell) const;
+
+	void BuildTable();
+	void FindPairsInBuckets(std::vector<BroadphasePair>& pairs);
+	void FindOversizedPairs(std::vector<BroadphasePair>& pairs);
+
+	float m_cellSize;
+	Stats m_stats;
+
+	std::vector<Proxy> m_proxies; // Indexed by id
+	std::vector<uint32_t> m_oversized;
+
+	uint32_t m_bucketMask = 0;
+	std::vector<uint32_t> m_bucketStarts; // Entries in bucket b are [m_bucketStarts[b], m_bucketStarts[b+1])
+	std::vector<uint32_t> m_bucketCursors;
+	std::vector<Entry> m_entries;
+};
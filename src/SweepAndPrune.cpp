@@ -0,0 +1,100 @@
+#include "SweepAndPrune.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <cmath>
+#include <limits>
+
+
+void SweepAndPrune::Add(uint32_t id, const Bounds& bounds, bool isStatic)
+{
+	if (id >= m_proxies.size()) {
+		m_proxies.resize(id + 1);
+	}
+	Proxy& proxy = m_proxies[id];
+	proxy.bounds = bounds;
+	proxy.isStatic = isStatic;
+	proxy.isActive = true;
+
+	// Appended to the end, the next sort moves it into place.
+	// An id removed and added again before a sort still has its endpoint.
+	if (!proxy.hasEndpoint) {
+		m_endpoints.push_back(Endpoint{ bounds.min[m_axis], id });
+		proxy.hasEndpoint = true;
+	}
+}
+
+void SweepAndPrune::Remove(uint32_t id)
+{
+	assert(id < m_proxies.size() && m_proxies[id].isActive);
+	m_proxies[id].isActive = false;
+}
+
+void SweepAndPrune::Update(uint32_t id, const Bounds& bounds)
+{
+	assert(id < m_proxies.size());
+	m_proxies[id].bounds = bounds;
+}
+
+void SweepAndPrune::SetStatic(uint32_t id, bool isStatic)
+{
+	assert(id < m_proxies.size());
+	m_proxies[id].isStatic = isStatic;
+}
+
+void SweepAndPrune::FindPairs(std::vector<BroadphasePair>& pairs)
+{
+	SortEndpoints();
+
+	const size_t endpointCount = m_endpoints.size();
+	for (size_t i = 0; i < endpointCount; i++)
+	{
+		const Proxy& proxy1 = m_proxies[m_endpoints[i].id];
+		const float maxOnAxis = proxy1.bounds.max[m_axis];
+
+		// Everything after this in the list starts later, stop once they start after we end.
+		for (size_t j = i + 1; j < endpointCount && m_endpoints[j].min <= maxOnAxis; j++)
+		{
+			const Proxy& proxy2 = m_proxies[m_endpoints[j].id];
+			if (proxy1.isStatic && proxy2.isStatic) continue;
+
+			if (proxy1.bounds.Overlaps(proxy2.bounds)) {
+				uint32_t id1 = m_endpoints[i].id;
+				uint32_t id2 = m_endpoints[j].id;
+				pairs.push_back(id1 < id2 ? BroadphasePair{ id1, id2 } : BroadphasePair{ id2, id1 });
+			}
+		}
+	}
+}
+
+void SweepAndPrune::SortEndpoints()
+{
+	// Drop the endpoints of removed proxies, keeping the order of the rest
+	auto isRemoved = [this](const Endpoint& endpoint) {
+		Proxy& proxy = m_proxies[endpoint.id];
+		if (proxy.isActive) return false;
+		proxy.hasEndpoint = false;
+		return true;
+	};
+	m_endpoints.erase(std::remove_if(std::begin(m_endpoints), std::end(m_endpoints), isRemoved), std::end(m_endpoints));
+
+	for (auto& endpoint : m_endpoints)
+	{
+		endpoint.min = m_proxies[endpoint.id].bounds.min[m_axis];
+
+		// Bounds that aren't a number can't overlap anything, sort them to the end so the order holds
+		if (std::isnan(endpoint.min)) endpoint.min = std::numeric_limits<float>::infinity();
+	}
+
+	// Insertion sort, the list is nearly sorted from the last frame.
+	for (size_t i = 1; i < m_endpoints.size(); i++)
+	{
+		Endpoint endpoint = m_endpoints[i];
+		size_t j = i;
+		while (j > 0 && m_endpoints[j - 1].min > endpoint.min) {
+			m_endpoints[j] = m_endpoints[j - 1];
+			j--;
+		}
+		m_endpoints[j] = endpoint;
+	}
+}
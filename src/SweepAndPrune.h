@@ -0,0 +1,40 @@
+#pragma once
+
+#include "Broadphase.h"
+
+// Keeps the bodies sorted along one axis and sweeps that list for overlaps.
+// The sort order is kept between frames, bodies only move a little each step so
+//   an insertion sort brings it back in order in close to linear time.
+class SweepAndPrune : public Broadphase
+{
+public:
+	SweepAndPrune(int axis = 0) : m_axis(axis) {}
+
+	void Add(uint32_t id, const Bounds& bounds, bool isStatic) override;
+	void Remove(uint32_t id) override;
+	void Update(uint32_t id, const Bounds& bounds) override;
+	void SetStatic(uint32_t id, bool isStatic) override;
+	void FindPairs(std::vector<BroadphasePair>& pairs) override;
+
+private:
+	struct Proxy
+	{
+		Bounds bounds;
+		bool isStatic;
+		bool isActive;
+		bool hasEndpoint; // Endpoints of removed proxies are dropped by the next sort
+	};
+
+	// The start of a proxy's interval along the sort axis
+	struct Endpoint
+	{
+		float min;
+		uint32_t id;
+	};
+
+	void SortEndpoints();
+
+	int m_axis;
+	std::vector<Proxy> m_proxies; // Indexed by id
+	std::vector<Endpoint> m_endpoints; // Sorted by min along the axis
+};
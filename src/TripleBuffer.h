@@ -0,0 +1,41 @@
+#pragma once
+
+#include <atomic>
+
+// Hands values from one thread to another without either of them waiting.
+// The writer fills the back buffer and publishes it. The reader swaps in the latest published
+//   buffer as its front buffer and reads that until it swaps again. The third buffer is the
+//   one published last, so a swap never has to wait for the other side to let go.
+// One writing thread and one reading thread.
+template<typename T>
+class TripleBuffer
+{
+public:
+	T& GetBackBuffer() { return m_buffers[m_backIndex]; }
+	const T& GetFrontBuffer() const { return m_buffers[m_frontIndex]; }
+
+	// Hands over the back buffer, the writer gets the one published before it to fill next
+	void Publish()
+	{
+		m_backIndex = m_publishedIndex.exchange(m_backIndex | NewFlag, std::memory_order_acq_rel) & IndexMask;
+	}
+
+	// Swaps in the last published buffer if there's one the reader hasn't seen.
+	// Returns false, and keeps the front buffer, if nothing has been published since.
+	bool SwapFront()
+	{
+		if ((m_publishedIndex.load(std::memory_order_relaxed) & NewFlag) == 0) return false;
+
+		m_frontIndex = m_publishedIndex.exchange(m_frontIndex, std::memory_order_acq_rel) & IndexMask;
+		return true;
+	}
+
+private:
+	static const unsigned int IndexMask = 3;
+	static const unsigned int NewFlag = 4;
+
+	T m_buffers[3];
+	unsigned int m_backIndex = 0;
+	std::atomic<unsigned int> m_publishedIndex{ 1 };
+	unsigned int m_frontIndex = 2;
+};
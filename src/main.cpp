@@ -19,4 +19,4 @@ int main()
     app.shutdown();
 
     return 0;
-}
\ No newline at end of file
+}